@@ -40,10 +40,12 @@
 #include <math.h>
 #include <net/if.h>
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -99,37 +101,49 @@ workerThread(void* pData);
 //                 GLOBALS
 ///////////////////////////////////////////////////
 
-// Seconds for 24h
-#define SPAN24 (24 * 3600)
-
-//-----------------------------------------------------------------------------
-//                   Helpers for sunrise/sunset calculations
-//-----------------------------------------------------------------------------
-
-// C program calculating the sunrise and sunset for
-// the current date and a fixed location(latitude,longitude)
-// Note, twilight calculation gives insufficient accuracy of results
-// Jarmo Lammi 1999 - 2001
-// Last update July 21st, 2001
-
-static double pi = 3.14159;
-static double degs;
-static double rads;
-
-static double L, g, daylen;
-static double SunDia = 0.53; // Sun radius degrees
+// One kind of solar event sent by the driver
+struct automationEventType
+{
+    uint16_t id;         // AUTOMATION_DEADLINE_xxx for the instance
+    uint16_t vscp_class;
+    uint16_t vscp_type;
+    const char* name;    // Name in statistics
+};
 
-static double AirRefr = 34.0 / 60.0; // atmospheric refraction degrees //
+// Solar events in SITE_TIME_xxx order. A new kind of event is a new
+// SITE_TIME_xxx and a line here.
+static constexpr automationEventType eventTypes[] = {
+    { AUTOMATION_DEADLINE_SUNRISE_TWILIGHT,
+      VSCP_CLASS1_INFORMATION,
+      VSCP_TYPE_INFORMATION_SUNRISE_TWILIGHT_START,
+      "sunrise-twilight" },
+    { AUTOMATION_DEADLINE_SUNRISE,
+      VSCP_CLASS1_INFORMATION,
+      VSCP_TYPE_INFORMATION_SUNRISE,
+      "sunrise" },
+    { AUTOMATION_DEADLINE_NOON,
+      VSCP_CLASS1_INFORMATION,
+      VSCP_TYPE_INFORMATION_CALCULATED_NOON,
+      "noon" },
+    { AUTOMATION_DEADLINE_SUNSET,
+      VSCP_CLASS1_INFORMATION,
+      VSCP_TYPE_INFORMATION_SUNSET,
+      "sunset" },
+    { AUTOMATION_DEADLINE_SUNSET_TWILIGHT,
+      VSCP_CLASS1_INFORMATION,
+      VSCP_TYPE_INFORMATION_SUNSET_TWILIGHT_START,
+      "sunset-twilight" }
+};
 
-//-----------------------------------------------------------------------------
-//                       End of sunset/sunrise functions
-//-----------------------------------------------------------------------------
+static_assert(sizeof(eventTypes) / sizeof(eventTypes[0]) == SITE_TIME_COUNT,
+              "One event type is needed for each SITE_TIME_xxx");
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constructor
 //
 
 CAutomation::CAutomation(void)
+  : m_receiveQueue(AUTOMATION_RECEIVE_QUEUE_SIZE)
 {
     m_bDebug = false;
     m_bQuit = false;
@@ -156,24 +170,63 @@ CAutomation::CAutomation(void)
     m_daylength = 0.0f;
     m_SunMaxAltitude = 0.0f;
 
-    m_bCalulationHasBeenDone = false; // No calculations has been done yet
+    m_lastCalcTime = time(NULL);
+
+    vscp_clearVSCPFilter(&m_vscpfilter); // Accept all events
 
-    // Set to some early date to indicate that they have not been sent
-    m_civilTwilightSunriseTime_sent = vscpdatetime::dateTimeZero();
-    m_SunriseTime_sent = vscpdatetime::dateTimeZero();
-    m_SunsetTime_sent = vscpdatetime::dateTimeZero();
-    m_civilTwilightSunsetTime_sent = vscpdatetime::dateTimeZero();
-    m_noonTime_sent = vscpdatetime::dateTimeZero();
+    pthread_mutex_init(&m_mutexSendQueue, NULL);
 
-    m_lastCalculation = vscpdatetime::Now();
+    m_scheduleDays = SCHEDULEFILE_DEFAULT_DAYS;
+    m_solarEngine = SOLAR_ENGINE_LEGACY;
 
-    vscp_clearVSCPFilter(&m_vscpfilter); // Accept all events
+    m_pTimezone = CTimeZone::get("");
+    memset(m_solarTime, 0, sizeof(m_solarTime));
 
-    sem_init(&m_semSendQueue, 0, 0);
-    sem_init(&m_semReceiveQueue, 0, 0);
+    // Zero indicates that they have not been sent
+    memset(m_solarSent, 0, sizeof(m_solarSent));
 
-    pthread_mutex_init(&m_mutexSendQueue, NULL);
-    pthread_mutex_init(&m_mutexReceiveQueue, NULL);
+    // Let all events through until the configuration is read
+    CFilterRules* prules = new CFilterRules;
+    prules->compile();
+    m_pFilterRules.store(prules);
+    m_pRetiredRules.store(NULL);
+    m_filterGeneration = 0;
+    m_filterRuleCount = 0;
+    m_templateGeneration = 0;
+
+    // Needs the filter rules
+    buildEventTemplates();
+
+    m_bSharedThread = false;
+    m_nSharedThreads = AUTOMATION_SHARED_THREADS;
+    m_pExecutor = NULL;
+
+    m_receiveFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (-1 == m_receiveFd) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to create receive event "
+               "descriptor. errno=%d",
+               errno);
+    }
+    m_bReceiveFd = false;
+
+    m_receiveQueueSize = AUTOMATION_RECEIVE_QUEUE_SIZE;
+    m_receiveQueuePolicy = AUTOMATION_QUEUE_DROP_NEWEST;
+    m_receiveQueueTimeout = AUTOMATION_RECEIVE_QUEUE_TIMEOUT;
+    m_bReceiveQueueFull = false;
+    m_receiveDropped = 0;
+    m_receiveCoalesced = 0;
+    m_receiveFiltered = 0;
+    m_sendBatchFull = 0;
+    m_receiveHighWater = 0;
+
+    // Deadlines before startup are not missed
+    m_calcDay = 0;
+    m_checkedUntil = time(NULL) - 1;
+    m_catchupGrace = AUTOMATION_CATCHUP_GRACE;
+    m_clockJumps = 0;
+    m_lateEvents = 0;
+    m_missedEvents = 0;
 
     // Do initial calculations
     doCalc();
@@ -187,11 +240,26 @@ CAutomation::~CAutomation(void)
 {
     close();
 
-    sem_destroy(&m_semSendQueue);
-    sem_destroy(&m_semReceiveQueue);
+    // Remove events not read by the host
+    vscpEvent* pev;
+    while (m_receiveQueue.pop(pev)) {
+        m_receivePool.release(pev);
+    }
+
+    // Remove events not handled by the worker thread
+    while (m_sendList.size()) {
+        m_sendPool.release(m_sendList.front());
+        m_sendList.pop_front();
+    }
+
+    if (-1 != m_receiveFd) {
+        ::close(m_receiveFd);
+    }
+
+    freeRetiredFilterRules();
+    delete m_pFilterRules.load();
 
     pthread_mutex_destroy(&m_mutexSendQueue);
-    pthread_mutex_destroy(&m_mutexReceiveQueue);
 }
 
 // ----------------------------------------------------------------------------
@@ -368,12 +436,53 @@ CAutomation::open(const std::string& path, cguid& guid)
                path.c_str());
     }
 
-    // start the workerthread
-    if (pthread_create(&m_threadWork, NULL, workerThread, this)) {
+    // GUID, zone and subzone are known now
+    buildEventTemplates();
+
+    // Nothing is queued before the worker starts
+    if (m_receiveQueue.capacity() < m_receiveQueueSize) {
+        m_receiveQueue.setCapacity(m_receiveQueueSize);
+    }
+
+    // Precalculated times
+    if (!m_scheduleFile.empty() && !loadSchedule()) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Schedule file [%s] not used. Times "
+               "will be calculated.",
+               m_scheduleFile.c_str());
+    }
+
+    // Calculate again with the configured location(s)
+    doCalc();
 
+    // Waiting for room would stall all instances on the shared thread
+    if (m_bSharedThread && (AUTOMATION_QUEUE_BLOCK == m_receiveQueuePolicy)) {
         syslog(LOG_ERR,
-               "[vscpl2drv-automation] Unable to start worker thread.");
-        return false;
+               "[vscpl2drv-automation] Receive queue policy 'block' can not "
+               "be used with 'shared-thread'. 'drop-newest' will be used.");
+        m_receiveQueuePolicy = AUTOMATION_QUEUE_DROP_NEWEST;
+    }
+
+    if (m_bSharedThread) {
+
+        // Served by the process wide executor
+        if (NULL == (m_pExecutor = CExecutor::get(m_nSharedThreads))) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Unable to start shared executor.");
+            return false;
+        }
+
+        m_pExecutor->add(this);
+
+    } else {
+
+        // start the workerthread
+        if (pthread_create(&m_threadWork, NULL, workerThread, this)) {
+
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Unable to start worker thread.");
+            return false;
+        }
     }
 
     if (m_bDebug) {
@@ -403,23 +512,69 @@ CAutomation::close(void)
 
     m_bQuit = true; // terminate the thread
 
-    void* res;
-    int rv = pthread_join(m_threadWork, &res);
-    if (0 != rv) {
-        syslog(
-          LOG_ERR, "[vscpl2drv-automation] pthread_join failed error=%d", rv);
+    wakeReaders();
+
+    if (NULL != m_pExecutor) {
+
+        // Waits if the executor is running us right now
+        m_pExecutor->remove(this);
+        m_pExecutor = NULL;
+        CExecutor::put();
+
+    } else {
+
+        m_scheduler.wakeup();
+
+        void* res;
+        int rv = pthread_join(m_threadWork, &res);
+        if (0 != rv) {
+            syslog(
+              LOG_ERR, "[vscpl2drv-automation] pthread_join failed error=%d", rv);
+        }
+
+        if (NULL != res) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Worker thread did not returned NULL");
+        }
     }
 
-    if (NULL != res) {
-        syslog(LOG_ERR,
-               "[vscpl2drv-automation] Worker thread did not returned NULL");
+    // Save statistics
+    if (!m_statisticsFile.empty()) {
+        std::string str;
+        getStatistics(str);
+        std::ofstream fs(m_statisticsFile.c_str());
+        fs << str << std::endl;
+        if (!fs) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Failed to write statistics to [%s]",
+                   m_statisticsFile.c_str());
+        }
     }
 
     if (m_bDebug) {
+        syslog(LOG_DEBUG,
+               "[vscpl2drv-automation] Event pool: receive alloc=%llu "
+               "release=%llu heap=%llu send alloc=%llu release=%llu heap=%llu",
+               (unsigned long long)m_receivePool.getAllocCount(),
+               (unsigned long long)m_receivePool.getReleaseCount(),
+               (unsigned long long)m_receivePool.getHeapAllocCount(),
+               (unsigned long long)m_sendPool.getAllocCount(),
+               (unsigned long long)m_sendPool.getReleaseCount(),
+               (unsigned long long)m_sendPool.getHeapAllocCount());
         syslog(LOG_DEBUG, "[vscpl2drv-automation] Driver closed.");
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// wakeReaders
+//
+
+void
+CAutomation::wakeReaders(void)
+{
+    m_receiveQueue.close();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // isDaylightSavingTime
 //
@@ -430,8 +585,10 @@ CAutomation::isDaylightSavingTime(void)
     time_t rawtime;
     struct tm* timeinfo;
 
+    struct tm tmbuf;
+
     time(&rawtime);
-    timeinfo = localtime(&rawtime);
+    timeinfo = localtime_r(&rawtime, &tmbuf);
     return timeinfo->tm_isdst;
 }
 
@@ -447,260 +604,206 @@ CAutomation::getTimeZoneDiffHours(void)
     struct tm* timeinfo_gmt;
     int h1, h2;
 
+    struct tm tmbuf, tmbuf_gmt;
+
     time(&rawtime);
-    timeinfo = localtime(&rawtime);
+    timeinfo = localtime_r(&rawtime, &tmbuf);
     h2 = timeinfo->tm_hour;
     if (0 == h2)
         h2 = 24;
 
-    timeinfo_gmt = gmtime(&rawtime);
+    timeinfo_gmt = gmtime_r(&rawtime, &tmbuf_gmt);
     h1 = timeinfo_gmt->tm_hour;
 
     return (h2 - h1);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// FNday
+// convert2HourMinute
 //
-// Get the days to J2000
-// h is UT in decimal hours
-// FNday only works between 1901 to 2099 - see Meeus chapter 7
+// Display decimal hours in hours and minutes
 //
 
-double
-CAutomation::FNday(int y, int m, int d, float h)
+void
+CAutomation::convert2HourMinute(double floatTime, int* pHours, int* pMinutes)
 {
-    long int luku = -7 * (y + (m + 9) / 12) / 4 + 275 * m / 9 + d;
-    // type casting necessary on PC DOS and TClite to avoid overflow
-    luku += (long int)y * 367;
-    return (double)luku - 730531.5 + h / 24.0;
+    solar_toHourMinute(floatTime, pHours, pMinutes);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-// FNrange
+// recordHours
 //
-// the function below returns an angle in the range
-// 0 to 2*pi
+// Local decimal hours from a schedule record time
 //
 
-double
-CAutomation::FNrange(double x)
+static double
+recordHours(int32_t t, double tzone)
 {
-    double b = 0.5 * x / pi;
-    double a = 2.0 * pi * (b - (long)(b));
-    if (a < 0)
-        a = 2.0 * pi + a;
-    return a;
-};
+    if (SITE_TIME_NONE == t) {
+        return NAN;
+    }
+
+    return (t + tzone * 3600) / 3600;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-// f0
-//
-// Calculating the hourangle
+// getLocalDateTime
 //
 
-double
-CAutomation::f0(double lat, double declin)
+vscpdatetime
+CAutomation::getLocalDateTime(time_t t) const
 {
-    double fo, dfo;
-    // Correction: different sign at S HS
-    dfo = rads * (0.5 * SunDia + AirRefr);
-    if (lat < 0.0)
-        dfo = -dfo;
-    fo = tan(declin + dfo) * tan(lat * rads);
-    if (fo > 0.99999)
-        fo = 1.0; // to avoid overflow //
-    fo = asin(fo) + pi / 2.0;
-    return fo;
-};
+    struct tm tm;
+    int year, month, day;
 
-///////////////////////////////////////////////////////////////////////////////
-// f1
-//
-// Calculating the hourangle for twilight times
-//
+    if (!t) {
+        return vscpdatetime::dateTimeZero();
+    }
 
-double
-CAutomation::f1(double lat, double declin)
-{
-    double fi, df1;
-    // Correction: different sign at S HS
-    df1 = rads * 6.0;
-    if (lat < 0.0)
-        df1 = -df1;
-    fi = tan(declin + df1) * tan(lat * rads);
-    if (fi > 0.99999)
-        fi = 1.0; // to avoid overflow //
-    fi = asin(fi) + pi / 2.0;
-    return fi;
-};
+    int32_t days = m_pTimezone->getLocalDate(t, &year, &month, &day);
+    int32_t secs =
+      (int32_t)(t + m_pTimezone->getOffset(t) - (int64_t)days * 86400);
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = secs / 3600;
+    tm.tm_min = (secs / 60) % 60;
+    tm.tm_sec = secs % 60;
+
+    vscpdatetime dt;
+    dt.set(tm);
+    return dt;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-// FNsun
+// calcSun
 //
-//   Find the ecliptic longitude of the Sun
 
-double
-CAutomation::FNsun(double d)
+void
+CAutomation::doCalc(void)
 {
+    int year, month, day;
+    double hour;
+    double tzone = 0;
+    solarResult res;
 
-    //   mean longitude of the Sun
-    L = FNrange(280.461 * rads + .9856474 * rads * d);
+    // get the date and time from the user
+    // read system date and extract the year
 
-    //   mean anomaly of the Sun
-    g = FNrange(357.528 * rads + .9856003 * rads * d);
+    // Local date and time in the zone of the instance
+    time_t now = time(NULL);
+    int32_t today = m_pTimezone->getLocalDate(now, &year, &month, &day);
+    hour = (int)((now + m_pTimezone->getOffset(now) - (int64_t)today * 86400) / 3600);
+    time_t dayStart = m_pTimezone->getMidnight(year, month, day);
 
-    //   Ecliptic longitude of the Sun
-    return FNrange(L + 1.915 * rads * sin(g) + .02 * rads * sin(2 * g));
-};
+    // Offset from UTC for the day, daylight saving time included
+    tzone = m_pTimezone->getNoonOffset(year, month, day) / 3600.0;
 
-///////////////////////////////////////////////////////////////////////////////
-// convert2HourMinute
-//
-// Display decimal hours in hours and minutes
-//
+    // Take the times from the schedule file if there is one
+    const scheduleRecord* prec = NULL;
+    if (!m_scheduleFile.empty()) {
 
-void
-CAutomation::convert2HourMinute(double floatTime, int* pHours, int* pMinutes)
-{
-    *pHours = ((int)floatTime) % 24;
-    *pMinutes = ((int)((floatTime - (double)*pHours) * 60)) % 60;
-};
+        // Out of date, generate a new one
+        if ((NULL == (prec = m_schedule.getRecord(0, today))) && loadSchedule()) {
+            prec = m_schedule.getRecord(0, today);
+        }
+    }
+
+    if (NULL != prec) {
+        // Seconds from UTC midnight to local decimal hours
+        res.twilightSunrise = recordHours(prec->time[SITE_TIME_SUNRISE_TWILIGHT], tzone);
+        res.sunrise = recordHours(prec->time[SITE_TIME_SUNRISE], tzone);
+        res.noon = recordHours(prec->time[SITE_TIME_NOON], tzone);
+        res.sunset = recordHours(prec->time[SITE_TIME_SUNSET], tzone);
+        res.twilightSunset = recordHours(prec->time[SITE_TIME_SUNSET_TWILIGHT], tzone);
+        res.daylength = prec->daylength / 3600.0;
+        res.declination = prec->declination;
+        res.maxAltitude = 90.0 + res.declination - m_latitude;
+        if (m_latitude < res.declination) {
+            res.maxAltitude = 180.0 - res.maxAltitude;
+        }
+    } else if (SOLAR_ENGINE_NOAA == m_solarEngine) {
+        solar_calculateNoaa(
+          year, month, day, m_latitude, m_longitude, tzone, &res);
+    } else {
+        solar_calculate(
+          year, month, day, hour, m_latitude, m_longitude, tzone, &res);
+    }
+
+    m_declination = res.declination;
+    m_daylength = res.daylength;
+    m_SunMaxAltitude = res.maxAltitude;
+
+    // All other sites in one go
+    if ((NULL == prec) || !m_sites.loadSchedule(m_schedule, 1, dayStart)) {
+        m_sites.calculate(dayStart, m_solarEngine);
+    }
+
+    // Set last calculated time
+    m_lastCalcTime = now;
+    m_calcDay = today;
+
+    // Times to the second
+    double hours[SITE_TIME_COUNT];
+    hours[SITE_TIME_SUNRISE_TWILIGHT] = res.twilightSunrise;
+    hours[SITE_TIME_SUNRISE] = res.sunrise;
+    hours[SITE_TIME_NOON] = res.noon;
+    hours[SITE_TIME_SUNSET] = res.sunset;
+    hours[SITE_TIME_SUNSET_TWILIGHT] = res.twilightSunset;
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        int32_t secs = CSiteTable::toUtcSeconds(hours[what], tzone);
+        m_solarTime[what] =
+          (SITE_TIME_NONE == secs) ? 0 : ((time_t)today * 86400 + secs);
+    }
+
+    // New deadlines for the worker thread
+    scheduleDeadlines();
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-// calcSun
+// scheduleDeadlines
 //
 
 void
-CAutomation::doCalc(void)
+CAutomation::scheduleDeadlines(void)
 {
-    double year, month, day, hour;
-    double d, lambda;
-    double obliq, alpha, delta, LL, equation, ha, hb, twx;
-    double twilightSunrise, maxAltitude, noonTime, sunsetTime, sunriseTime,
-      twilightSunset;
-    double tzone = 0;
+    int year, month, day;
 
-    degs = 180.0 / pi;
-    rads = pi / 180.0;
+    m_scheduler.clear();
 
-    // get the date and time from the user
-    // read system date and extract the year
+    // Recalculation at next local midnight
+    CTimeZone::civilFromDays(m_calcDay + 1, &year, &month, &day);
+    m_scheduler.addDeadline(m_pTimezone->getMidnight(year, month, day),
+                            AUTOMATION_DEADLINE_CALC);
 
-    // First get time
-    vscpdatetime nowLocal = vscpdatetime::Now();
-    year = nowLocal.getYear();
-    month = nowLocal.getMonth() + 1;
-    day = nowLocal.getDay();
-    hour = nowLocal.getHour();
-
-    // Set offset from UTC - daytimesaving is taken care of
-    // vscpdatetime::TimeZone ttt( vscpdatetime::Local );
-    // tzone = ttt.GetOffset()/3600;
-    tzone = vscpdatetime::tzOffset2LocalTime(); // TODO CHECK!!!!!!
-
-    // Adjust for daylight saving time
-    /*if ( isDaylightSavingTime() ) {
-        tzone = getTimeZoneDiffHours();
-    }*/
-
-    d = FNday(year, month, day, hour);
-
-    // Use FNsun to find the ecliptic longitude of the Sun
-    lambda = FNsun(d);
-
-    //   Obliquity of the ecliptic
-    obliq = 23.439 * rads - 0.0000004 * rads * d;
-
-    //   Find the RA and DEC of the Sun
-    alpha = atan2(cos(obliq) * sin(lambda), cos(lambda));
-    delta = asin(sin(obliq) * sin(lambda));
-
-    // Find the Equation of Time
-    // in minutes
-    // Correction suggested by David Smith
-    LL = L - alpha;
-    if (L < pi)
-        LL += 2.0 * pi;
-    equation = 1440.0 * (1.0 - LL / pi / 2.0);
-    ha = f0(m_latitude, delta);
-    hb = f1(m_latitude, delta);
-    twx = hb - ha;         // length of twilight in radians
-    twx = 12.0 * twx / pi; // length of twilight in hours
-
-    // Conversion of angle to hours and minutes
-    daylen = degs * ha / 7.5;
-    if (daylen < 0.0001) {
-        daylen = 0.0;
-    }
-
-    // arctic winter
-    sunriseTime =
-      12.0 - 12.0 * ha / pi + tzone - m_longitude / 15.0 + equation / 60.0;
-    sunsetTime =
-      12.0 + 12.0 * ha / pi + tzone - m_longitude / 15.0 + equation / 60.0;
-    noonTime = sunriseTime + 12.0 * ha / pi;
-    maxAltitude = 90.0 + delta * degs - m_latitude;
-    // Correction for S HS suggested by David Smith
-    // to express altitude as degrees from the N horizon
-    if (m_latitude < delta * degs)
-        maxAltitude = 180.0 - maxAltitude;
-
-    twilightSunrise = sunriseTime - twx; // morning twilight begin
-    twilightSunset = sunsetTime + twx;   // evening twilight end
-
-    if (sunriseTime > 24.0)
-        sunriseTime -= 24.0;
-    if (sunsetTime > 24.0)
-        sunsetTime -= 24.0;
-    if (twilightSunrise > 24.0)
-        twilightSunrise -= 24.0; // 160921
-    if (twilightSunset > 24.0)
-        twilightSunset -= 24.0;
-
-    m_declination = delta * degs;
-    m_daylength = daylen;
-    m_SunMaxAltitude = maxAltitude;
+    // Deadlines already handled are not sent again, missed ones are
+    // sent if they are within the grace time
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        if (isEventEnabled(what) && m_eventTemplate[what].bSend &&
+            (m_solarTime[what] > m_checkedUntil)) {
+            m_scheduler.addDeadline(m_solarTime[what], eventTypes[what].id);
+        }
+    }
 
-    // Set last calculated time
-    m_lastCalculation = vscpdatetime::Now();
-
-    int intHour, intMinute;
-
-    // Civil Twilight Sunrise
-    convert2HourMinute(twilightSunrise, &intHour, &intMinute);
-    m_civilTwilightSunriseTime = vscpdatetime::Now();
-    m_civilTwilightSunriseTime.zeroTime(); // Set to midnight
-    m_civilTwilightSunriseTime.setHour(intHour);
-    m_civilTwilightSunriseTime.setMinute(intMinute);
-
-    // Sunrise
-    convert2HourMinute(sunriseTime, &intHour, &intMinute);
-    m_SunriseTime = vscpdatetime::Now();
-    m_SunriseTime.zeroTime(); // Set to midnight
-    m_SunriseTime.setHour(intHour);
-    m_SunriseTime.setMinute(intMinute);
-
-    // Sunset
-    convert2HourMinute(sunsetTime, &intHour, &intMinute);
-    m_SunsetTime = vscpdatetime::Now();
-    m_SunsetTime.zeroTime(); // Set to midnight
-    m_SunsetTime.setHour(intHour);
-    m_SunsetTime.setMinute(intMinute);
-
-    // Civil Twilight Sunset
-    convert2HourMinute(twilightSunset, &intHour, &intMinute);
-    m_civilTwilightSunsetTime = vscpdatetime::Now();
-    m_civilTwilightSunsetTime.zeroTime(); // Set to midnight
-    m_civilTwilightSunsetTime.setHour(intHour);
-    m_civilTwilightSunsetTime.setMinute(intMinute);
-
-    // NoonTime
-    convert2HourMinute(noonTime, &intHour, &intMinute);
-    m_noonTime = vscpdatetime::Now();
-    m_noonTime.zeroTime(); // Set to midnight
-    m_noonTime.setHour(intHour);
-    m_noonTime.setMinute(intMinute);
+    // Sites. Times from the next local day of a site that are after
+    // the next recalculation are scheduled again by it.
+    for (size_t i = 0; i < m_sites.size(); i++) {
+        for (int what = 0; what < SITE_TIME_COUNT; what++) {
+            if (!m_sites.isEnabled(i, what) ||
+                !m_eventTemplate[what].bSend) {
+                continue;
+            }
+            for (int d = 0; d < SITE_DAYS; d++) {
+                time_t deadline = m_sites.getTime(i, what, d);
+                if (deadline > m_checkedUntil) {
+                    m_scheduler.addDeadline(deadline,
+                                            AUTOMATION_DEADLINE_SITE(i, what));
+                }
+            }
+        }
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -842,7 +945,7 @@ CAutomation::doLoadConfig(void)
 
     try {
         if (m_j_config.contains("write-enable") && m_j_config["write-enable"].is_boolean()) { 
-            m_bDebug = m_j_config["write-enable"].get<bool>();
+            m_bWrite = m_j_config["write-enable"].get<bool>();
         } else {
             syslog(LOG_ERR, "ReadConfig: Failed to read 'write-debug'. Default will be used.");
         }
@@ -857,7 +960,7 @@ CAutomation::doLoadConfig(void)
 
     try {
         if (m_j_config.contains("zone") && m_j_config["zone"].is_number()) { 
-            m_bDebug = m_j_config["zone"].get<bool>();
+            m_zone = m_j_config["zone"].get<uint8_t>();
         } else {
             syslog(LOG_ERR, "ReadConfig: Failed to read 'zone'. Default will be used.");
         }
@@ -872,7 +975,7 @@ CAutomation::doLoadConfig(void)
 
     try {
         if (m_j_config.contains("subzone") && m_j_config["subzone"].is_number()) { 
-            m_bDebug = m_j_config["subzone"].get<bool>();
+            m_subzone = m_j_config["subzone"].get<uint8_t>();
         } else {
             syslog(LOG_ERR, "ReadConfig: Failed to read 'subzone'. Default will be used.");
         }
@@ -887,7 +990,7 @@ CAutomation::doLoadConfig(void)
 
     try {
         if (m_j_config.contains("longitude") && m_j_config["longitude"].is_number()) { 
-            m_longitude = m_j_config["longitude"].get<bool>();
+            m_longitude = m_j_config["longitude"].get<double>();
         } else {
             syslog(LOG_ERR, "ReadConfig: Failed to read 'longitude'. Default will be used.");
         }
@@ -902,7 +1005,7 @@ CAutomation::doLoadConfig(void)
 
     try {
         if (m_j_config.contains("latitude") && m_j_config["latitude"].is_number()) { 
-            m_latitude = m_j_config["latitude"].get<bool>();
+            m_latitude = m_j_config["latitude"].get<double>();
         } else {
             syslog(LOG_ERR, "ReadConfig: Failed to read 'latitude'. Default will be used.");
         }
@@ -975,87 +1078,685 @@ CAutomation::doLoadConfig(void)
         syslog(LOG_ERR, "ReadConfig: Failed to read 'sunset-twilight-enable'. Default will be used.");
     }
 
-    // if (!readEncryptionKey(m_j_config.value("vscp-key-file", ""))) {
-    //     syslog(LOG_ERR, "[vscpl2drv-automation] WARNING!!! Default key will be used.");
-    //     // Not secure of course but something...
-    //     m_vscpkey = "Carpe diem quam minimum credula postero";
-    // }
-
-    
+    try {
+        if (m_j_config.contains("noon-enable") && m_j_config["noon-enable"].is_boolean()) { 
+            m_bCalculatedNoonEvent = m_j_config["noon-enable"].get<bool>();
+        }
 
-    
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'noon-enable' set to %s", m_bCalculatedNoonEvent ? "true" : "false");
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'noon-enable'. Default will be used.");
+    }
 
-    return true;
-}
+    try {
+        if (m_j_config.contains("filter") && m_j_config["filter"].is_string()) { 
+            std::string str = m_j_config["filter"].get<std::string>();
+            if (!vscp_readFilterFromString(&m_vscpfilter, str)) {
+                syslog(LOG_ERR, "ReadConfig: Failed to parse 'filter' [%s]. Default will be used.", str.c_str());
+            }
+            else if (m_bDebug) {
+                syslog(LOG_DEBUG, "ReadConfig: 'filter' set to [%s]", str.c_str());
+            }
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'filter'. Default will be used.");
+    }
 
-///////////////////////////////////////////////////////////////////////////////
-// saveConfiguration
-//
+    try {
+        if (m_j_config.contains("mask") && m_j_config["mask"].is_string()) { 
+            std::string str = m_j_config["mask"].get<std::string>();
+            if (!vscp_readMaskFromString(&m_vscpfilter, str)) {
+                syslog(LOG_ERR, "ReadConfig: Failed to parse 'mask' [%s]. Default will be used.", str.c_str());
+            }
+            else if (m_bDebug) {
+                syslog(LOG_DEBUG, "ReadConfig: 'mask' set to [%s]", str.c_str());
+            }
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'mask'. Default will be used.");
+    }
 
-bool
-CAutomation::doSaveConfig(void)
-{
-    return true;
-}
+    // Filter rules. Without them the filter/mask pair is the only rule.
+    CFilterRules* prules = NULL;
+    try {
+        if (m_j_config.contains("filter-rules") && m_j_config["filter-rules"].is_array()) { 
+            prules = getFilterRulesConfig(m_j_config["filter-rules"]);
+            if (NULL == prules) {
+                syslog(LOG_ERR, "ReadConfig: Failed to read 'filter-rules'. 'filter' and 'mask' will be used.");
+            }
+            else if (m_bDebug) {
+                syslog(LOG_DEBUG, "ReadConfig: 'filter-rules' set to %u rules", (unsigned)prules->size());
+            }
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'filter-rules'. 'filter' and 'mask' will be used.");
+    }
 
-///////////////////////////////////////////////////////////////////////////////
-// parseHLO
-//
+    if (NULL == prules) {
+        prules = new CFilterRules;
+        prules->add(m_vscpfilter, true);
+        prules->compile();
+    }
 
-bool
-CAutomation::parseHLO(uint16_t size, uint8_t* inbuf, CHLO* phlo)
-{
-    // // Check pointers
-    // if (NULL == inbuf) {
-    //     syslog(
-    //       LOG_ERR,
-    //       "[vscpl2drv-automation] HLO parser: HLO in-buffer pointer is NULL.");
-    //     return false;
-    // }
+    setFilterRules(prules);
 
-    // if (NULL == phlo) {
-    //     syslog(LOG_ERR,
-    //            "[vscpl2drv-automation] HLO parser: HLO obj pointer is NULL.");
-    //     return false;
-    // }
+    try {
+        if (m_j_config.contains("shared-thread") && m_j_config["shared-thread"].is_boolean()) { 
+            m_bSharedThread = m_j_config["shared-thread"].get<bool>();
+        } else {
+            syslog(LOG_ERR, "ReadConfig: Failed to read 'shared-thread'. Default will be used.");
+        }
 
-    // if (!size) {
-    //     syslog(LOG_ERR,
-    //            "[vscpl2drv-automation] HLO parser: HLO buffer size is zero.");
-    //     return false;
-    // }
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'shared-thread' set to %s", m_bSharedThread ? "true" : "false");
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'shared-thread'. Default will be used.");
+    }
 
-    // XML_Parser xmlParser = XML_ParserCreate("UTF-8");
-    // XML_SetUserData(xmlParser, this);
-    // XML_SetElementHandler(xmlParser, startHLOParser, endHLOParser);
+    try {
+        if (m_j_config.contains("shared-thread-count") && m_j_config["shared-thread-count"].is_number()) { 
+            m_nSharedThreads = m_j_config["shared-thread-count"].get<int>();
+        } else {
+            syslog(LOG_ERR, "ReadConfig: Failed to read 'shared-thread-count'. Default will be used.");
+        }
 
-    // void* buf = XML_GetBuffer(xmlParser, XML_BUFF_SIZE);
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'shared-thread-count' set to %d", m_nSharedThreads);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'shared-thread-count'. Default will be used.");
+    }
 
-    // // Copy in the HLO object
-    // memcpy(buf, inbuf, size);
+    try {
+        if (m_j_config.contains("timezone")) {
+            const CTimeZone* ptz = getTimezoneConfig(m_j_config["timezone"]);
+            if (NULL != ptz) {
+                m_pTimezone = ptz;
+            } else {
+                syslog(LOG_ERR, "ReadConfig: Unknown 'timezone'. Default will be used.");
+            }
+        }
 
-    // if (!XML_ParseBuffer(xmlParser, size, size == 0)) {
-    //     syslog(LOG_ERR, "[vscpl2drv-automation] Failed parse XML setup.");
-    //     XML_ParserFree(xmlParser);
-    //     return false;
-    // }
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'timezone' set to [%s]", m_pTimezone->getName().c_str());
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'timezone'. Default will be used.");
+    }
 
-    // XML_ParserFree(xmlParser);
+    try {
+        m_sites.clear();
+        if (m_j_config.contains("sites") && m_j_config["sites"].is_array()) {
+            for (json::iterator it = m_j_config["sites"].begin(); it != m_j_config["sites"].end(); ++it) {
+                if (!readSiteConfig(*it)) {
+                    syslog(LOG_ERR, "ReadConfig: Failed to read site %d. Site ignored.", (int)(it - m_j_config["sites"].begin()));
+                }
+            }
+        }
 
-    return true;
-}
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: %d sites configured", (int)m_sites.size());
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'sites'. No sites will be used.");
+    }
 
-///////////////////////////////////////////////////////////////////////////////
-// handleHLO
-//
+    try {
+        if (m_j_config.contains("schedule-file") && m_j_config["schedule-file"].is_string()) { 
+            m_scheduleFile = m_j_config["schedule-file"].get<std::string>();
+        }
 
-bool
-CAutomation::handleHLO(vscpEvent* pEvent)
-{
-    json j;
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'schedule-file' set to [%s]", m_scheduleFile.c_str());
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'schedule-file'. Default will be used.");
+    }
 
-    // char buf[512]; // Working buffer
-    // vscpEventEx ex;
+    try {
+        if (m_j_config.contains("schedule-days") && m_j_config["schedule-days"].is_number()) { 
+            m_scheduleDays = m_j_config["schedule-days"].get<uint32_t>();
+            if (!m_scheduleDays) {
+                m_scheduleDays = SCHEDULEFILE_DEFAULT_DAYS;
+            }
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'schedule-days' set to %u", (unsigned)m_scheduleDays);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'schedule-days'. Default will be used.");
+    }
+
+    try {
+        if (m_j_config.contains("solar-engine") && m_j_config["solar-engine"].is_string()) { 
+            std::string engine = m_j_config["solar-engine"].get<std::string>();
+            if ("noaa" == engine) {
+                m_solarEngine = SOLAR_ENGINE_NOAA;
+            } else if ("legacy" == engine) {
+                m_solarEngine = SOLAR_ENGINE_LEGACY;
+            } else {
+                syslog(LOG_ERR, "ReadConfig: Unknown 'solar-engine' [%s]. Default will be used.", engine.c_str());
+            }
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'solar-engine' set to %d", m_solarEngine);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'solar-engine'. Default will be used.");
+    }
+
+    try {
+        if (m_j_config.contains("receive-queue-size") && m_j_config["receive-queue-size"].is_number()) { 
+            uint32_t size = m_j_config["receive-queue-size"].get<uint32_t>();
+            if (size) {
+                m_receiveQueueSize = size;
+            } else {
+                syslog(LOG_ERR, "ReadConfig: 'receive-queue-size' must be at least one. Default will be used.");
+            }
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'receive-queue-size' set to %u", m_receiveQueueSize);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'receive-queue-size'. Default will be used.");
+    }
+
+    try {
+        if (m_j_config.contains("receive-queue-policy") && m_j_config["receive-queue-policy"].is_string()) { 
+            std::string policy = m_j_config["receive-queue-policy"].get<std::string>();
+            if ("drop-newest" == policy) {
+                m_receiveQueuePolicy = AUTOMATION_QUEUE_DROP_NEWEST;
+            } else if ("drop-oldest" == policy) {
+                m_receiveQueuePolicy = AUTOMATION_QUEUE_DROP_OLDEST;
+            } else if ("coalesce" == policy) {
+                m_receiveQueuePolicy = AUTOMATION_QUEUE_COALESCE;
+            } else if ("block" == policy) {
+                m_receiveQueuePolicy = AUTOMATION_QUEUE_BLOCK;
+            } else {
+                syslog(LOG_ERR, "ReadConfig: Unknown 'receive-queue-policy' [%s]. Default will be used.", policy.c_str());
+            }
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'receive-queue-policy' set to %d", m_receiveQueuePolicy);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'receive-queue-policy'. Default will be used.");
+    }
+
+    try {
+        if (m_j_config.contains("receive-queue-timeout") && m_j_config["receive-queue-timeout"].is_number()) { 
+            m_receiveQueueTimeout = m_j_config["receive-queue-timeout"].get<uint32_t>();
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'receive-queue-timeout' set to %u", m_receiveQueueTimeout);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'receive-queue-timeout'. Default will be used.");
+    }
+
+    try {
+        if (m_j_config.contains("catch-up-grace") && m_j_config["catch-up-grace"].is_number()) { 
+            m_catchupGrace = m_j_config["catch-up-grace"].get<uint32_t>();
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'catch-up-grace' set to %u", m_catchupGrace);
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'catch-up-grace'. Default will be used.");
+    }
+
+    try {
+        if (m_j_config.contains("statistics-file") && m_j_config["statistics-file"].is_string()) { 
+            m_statisticsFile = m_j_config["statistics-file"].get<std::string>();
+        }
+
+        if (m_bDebug) {
+            syslog(LOG_DEBUG, "ReadConfig: 'statistics-file' set to [%s]", m_statisticsFile.c_str());
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Failed to read 'statistics-file'. Default will be used.");
+    }
+
+    // if (!readEncryptionKey(m_j_config.value("vscp-key-file", ""))) {
+    //     syslog(LOG_ERR, "[vscpl2drv-automation] WARNING!!! Default key will be used.");
+    //     // Not secure of course but something...
+    //     m_vscpkey = "Carpe diem quam minimum credula postero";
+    // }
+
+    
+
+    
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// readSiteConfig
+//
+
+bool
+CAutomation::readSiteConfig(json& j)
+{
+    if (!j.is_object() || !j.contains("latitude") || !j["latitude"].is_number() ||
+        !j.contains("longitude") || !j["longitude"].is_number()) {
+        return false;
+    }
+
+    if (m_sites.size() >= AUTOMATION_MAX_SITES) {
+        return false;
+    }
+
+    // Unset values are taken from the instance
+    const CTimeZone* ptz = m_pTimezone;
+    if (j.contains("timezone") && (NULL == (ptz = getTimezoneConfig(j["timezone"])))) {
+        return false;
+    }
+    uint8_t zone = j.value("zone", m_zone);
+    uint8_t subzone = j.value("subzone", m_subzone);
+
+    uint8_t enable = 0;
+    if (j.value("sunrise-twilight-enable", m_bSunRiseTwilightEvent)) {
+        enable |= (1 << SITE_TIME_SUNRISE_TWILIGHT);
+    }
+    if (j.value("sunrise-enable", m_bSunRiseEvent)) {
+        enable |= (1 << SITE_TIME_SUNRISE);
+    }
+    if (j.value("noon-enable", m_bCalculatedNoonEvent)) {
+        enable |= (1 << SITE_TIME_NOON);
+    }
+    if (j.value("sunset-enable", m_bSunSetEvent)) {
+        enable |= (1 << SITE_TIME_SUNSET);
+    }
+    if (j.value("sunset-twilight-enable", m_bSunSetTwilightEvent)) {
+        enable |= (1 << SITE_TIME_SUNSET_TWILIGHT);
+    }
+
+    m_sites.addSite(j["latitude"].get<double>(),
+                    j["longitude"].get<double>(),
+                    ptz,
+                    zone,
+                    subzone,
+                    enable);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getTimezoneConfig
+//
+
+const CTimeZone*
+CAutomation::getTimezoneConfig(json& j)
+{
+    if (j.is_number()) {
+        return CTimeZone::getFixed((int32_t)lround(j.get<double>() * 3600));
+    }
+
+    if (j.is_string()) {
+        return CTimeZone::get(j.get<std::string>());
+    }
+
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getFilterRulesConfig
+//
+
+CFilterRules*
+CAutomation::getFilterRulesConfig(json& j)
+{
+    CFilterRules* prules = new CFilterRules;
+
+    // Values of the wrong type throw
+    try {
+        for (json::iterator it = j.begin(); it != j.end(); ++it) {
+
+            vscpEventFilter filter;
+            json& jrule = *it;
+
+            if (!jrule.is_object()) {
+                syslog(LOG_ERR, "ReadConfig: Filter rule is not an object.");
+                delete prules;
+                return NULL;
+            }
+
+            std::string action = jrule.value("action", std::string("allow"));
+            if (("allow" != action) && ("deny" != action)) {
+                syslog(LOG_ERR,
+                       "ReadConfig: Invalid filter rule action [%s].",
+                       action.c_str());
+                delete prules;
+                return NULL;
+            }
+
+            vscp_clearVSCPFilter(&filter);
+            if ((jrule.contains("filter") &&
+                 !vscp_readFilterFromString(&filter, jrule["filter"].get<std::string>())) ||
+                (jrule.contains("mask") &&
+                 !vscp_readMaskFromString(&filter, jrule["mask"].get<std::string>()))) {
+                syslog(LOG_ERR, "ReadConfig: Invalid filter or mask in filter rule.");
+                delete prules;
+                return NULL;
+            }
+
+            // Short form for one class and/or type
+            if (jrule.contains("class")) {
+                filter.filter_class = jrule["class"].get<uint16_t>();
+                filter.mask_class = 0xffff;
+            }
+
+            if (jrule.contains("type")) {
+                filter.filter_type = jrule["type"].get<uint16_t>();
+                filter.mask_type = 0xffff;
+            }
+
+            if (!prules->add(filter, ("allow" == action))) {
+                syslog(LOG_ERR,
+                       "ReadConfig: More than %d filter rules.",
+                       FILTER_MAX_RULES);
+                delete prules;
+                return NULL;
+            }
+        }
+    }
+    catch (...) {
+        syslog(LOG_ERR, "ReadConfig: Invalid value in filter rule.");
+        delete prules;
+        return NULL;
+    }
+
+    prules->compile();
+    return prules;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setFilterRules
+//
+
+void
+CAutomation::setFilterRules(CFilterRules* prules)
+{
+    if (NULL == prules) {
+        return;
+    }
+
+    m_filterRuleCount = prules->size();
+    CFilterRules* pold = m_pFilterRules.exchange(prules);
+    m_filterGeneration++;
+
+    // The worker may still use the old set, it frees it on its next pass
+    CFilterRules* phead = m_pRetiredRules.load(std::memory_order_relaxed);
+    do {
+        pold->m_pnext = phead;
+    } while (!m_pRetiredRules.compare_exchange_weak(
+      phead, pold, std::memory_order_release, std::memory_order_relaxed));
+
+    // Templates and deadlines are updated by the worker
+    wakeWorker(1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadFilterRules
+//
+
+bool
+CAutomation::loadFilterRules(const std::string& str)
+{
+    json j;
+
+    try {
+        j = json::parse(str);
+    }
+    catch (...) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Filter rules are not valid JSON.");
+        return false;
+    }
+
+    if (!j.is_array()) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Filter rules must be a JSON array.");
+        return false;
+    }
+
+    CFilterRules* prules = getFilterRulesConfig(j);
+    if (NULL == prules) {
+        return false;
+    }
+
+    setFilterRules(prules);
+
+    if (m_bDebug) {
+        syslog(LOG_DEBUG,
+               "[vscpl2drv-automation] %u filter rules loaded.",
+               (unsigned)prules->size());
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// freeRetiredFilterRules
+//
+
+void
+CAutomation::freeRetiredFilterRules(void)
+{
+    // Take the whole stack, no ABA problem
+    CFilterRules* prules = m_pRetiredRules.exchange(NULL, std::memory_order_acquire);
+
+    while (NULL != prules) {
+        CFilterRules* pnext = prules->m_pnext;
+        delete prules;
+        prules = pnext;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getScheduleInput
+//
+
+uint64_t
+CAutomation::getScheduleInput(int32_t firstDay,
+                              uint32_t dayCount,
+                              std::vector<double>& lat,
+                              std::vector<double>& lon,
+                              std::vector<double>& tz)
+{
+    size_t nsites = 1 + m_sites.size();
+
+    lat.resize(nsites);
+    lon.resize(nsites);
+    tz.resize(nsites * dayCount);
+
+    lat[0] = m_latitude;
+    lon[0] = m_longitude;
+    for (size_t s = 1; s < nsites; s++) {
+        lat[s] = m_sites.getLatitude(s - 1);
+        lon[s] = m_sites.getLongitude(s - 1);
+    }
+
+    // Offset from UTC at local noon each day
+    for (size_t s = 0; s < nsites; s++) {
+        const CTimeZone* ptz = s ? m_sites.getTimeZone(s - 1) : m_pTimezone;
+        for (uint32_t d = 0; d < dayCount; d++) {
+            int year, month, day;
+            CTimeZone::civilFromDays(firstDay + d, &year, &month, &day);
+            tz[s * dayCount + d] = ptz->getNoonOffset(year, month, day) / 3600.0;
+        }
+    }
+
+    // Everything the calculated times depend on
+    uint64_t hash = CScheduleFile::hashInit();
+    hash = CScheduleFile::hashAdd(hash, &firstDay, sizeof(firstDay));
+    hash = CScheduleFile::hashAdd(hash, &dayCount, sizeof(dayCount));
+    hash = CScheduleFile::hashAdd(hash, &lat[0], nsites * sizeof(double));
+    hash = CScheduleFile::hashAdd(hash, &lon[0], nsites * sizeof(double));
+    hash = CScheduleFile::hashAdd(hash, &tz[0], tz.size() * sizeof(double));
+    hash = CScheduleFile::hashAdd(hash, &m_solarEngine, sizeof(m_solarEngine));
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadSchedule
+//
+
+bool
+CAutomation::loadSchedule(void)
+{
+    scheduleFileHeader hdr;
+    std::vector<double> lat, lon, tz;
+    size_t nsites = 1 + m_sites.size();
+
+    m_schedule.close();
+
+    if (m_scheduleFile.empty()) {
+        return false;
+    }
+
+    // Local date today as days since 1970-01-01
+    int year, month, day;
+    int32_t today = m_pTimezone->getLocalDate(time(NULL), &year, &month, &day);
+
+    // Sites west of the instance are on the day before when the day
+    // starts and sites east of it reach the day after
+    int32_t firstDay = today - 1;
+
+    // Use the existing file if it is valid for today
+    if (CScheduleFile::readHeader(m_scheduleFile, &hdr) &&
+        (hdr.firstDay <= firstDay) &&
+        ((uint32_t)(today + 1 - hdr.firstDay) < hdr.dayCount)) {
+
+        uint64_t hash = getScheduleInput(hdr.firstDay, hdr.dayCount, lat, lon, tz);
+        if (m_schedule.open(m_scheduleFile, hash, nsites)) {
+            if (m_bDebug) {
+                syslog(LOG_DEBUG,
+                       "[vscpl2drv-automation] Using schedule file [%s]",
+                       m_scheduleFile.c_str());
+            }
+            return true;
+        }
+    }
+
+    // Generate a new file starting yesterday
+    uint64_t hash = getScheduleInput(firstDay, m_scheduleDays + 1, lat, lon, tz);
+    if (!CScheduleFile::generate(m_scheduleFile,
+                                 hash,
+                                 firstDay,
+                                 m_scheduleDays + 1,
+                                 nsites,
+                                 &lat[0],
+                                 &lon[0],
+                                 &tz[0],
+                                 m_solarEngine)) {
+        return false;
+    }
+
+    if (m_bDebug) {
+        syslog(LOG_DEBUG,
+               "[vscpl2drv-automation] Generated schedule file [%s] for %u days",
+               m_scheduleFile.c_str(),
+               (unsigned)m_scheduleDays);
+    }
+
+    return m_schedule.open(m_scheduleFile, hash, nsites);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// saveConfiguration
+//
+
+bool
+CAutomation::doSaveConfig(void)
+{
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// parseHLO
+//
+
+bool
+CAutomation::parseHLO(uint16_t size, uint8_t* inbuf, CHLO* phlo)
+{
+    // // Check pointers
+    // if (NULL == inbuf) {
+    //     syslog(
+    //       LOG_ERR,
+    //       "[vscpl2drv-automation] HLO parser: HLO in-buffer pointer is NULL.");
+    //     return false;
+    // }
+
+    // if (NULL == phlo) {
+    //     syslog(LOG_ERR,
+    //            "[vscpl2drv-automation] HLO parser: HLO obj pointer is NULL.");
+    //     return false;
+    // }
+
+    // if (!size) {
+    //     syslog(LOG_ERR,
+    //            "[vscpl2drv-automation] HLO parser: HLO buffer size is zero.");
+    //     return false;
+    // }
+
+    // XML_Parser xmlParser = XML_ParserCreate("UTF-8");
+    // XML_SetUserData(xmlParser, this);
+    // XML_SetElementHandler(xmlParser, startHLOParser, endHLOParser);
+
+    // void* buf = XML_GetBuffer(xmlParser, XML_BUFF_SIZE);
+
+    // // Copy in the HLO object
+    // memcpy(buf, inbuf, size);
+
+    // if (!XML_ParseBuffer(xmlParser, size, size == 0)) {
+    //     syslog(LOG_ERR, "[vscpl2drv-automation] Failed parse XML setup.");
+    //     XML_ParserFree(xmlParser);
+    //     return false;
+    // }
+
+    // XML_ParserFree(xmlParser);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// handleHLO
+//
+
+bool
+CAutomation::handleHLO(vscpEvent* pEvent)
+{
+    json j;
+
+    // char buf[512]; // Working buffer
+    // vscpEventEx ex;
 
     // // Check pointers
     // if (NULL == pEvent) {
@@ -1136,7 +1837,7 @@ CAutomation::handleHLO(vscpEvent* pEvent)
     //                     "noon",
     //                     "OK",
     //                     VSCP_REMOTE_VARIABLE_CODE_DATETIME,
-    //                     vscp_convertToBase64(m_noonTime.getISODateTime()).c_str());
+    //                     vscp_convertToBase64(getNoonTime().getISODateTime()).c_str());
     //         } else if ("SENT-SUNRISE" == hlo.m_name) {
     //             sprintf(buf,
     //                     HLO_READ_VAR_REPLY_TEMPLATE,
@@ -1628,48 +2329,636 @@ CAutomation::handleHLO(vscpEvent* pEvent)
     //         doSaveConfig();
     //         break;
 
-    //     case HLO_OP_LOAD:
-    //         doLoadConfig();
-    //         break;
+    //     case HLO_OP_LOAD:
+    //         doLoadConfig();
+    //         break;
+
+    //     case HLO_USER_CALC_ASTRO:
+    //         doCalc();
+    //         break;
+
+    //     default:
+    //         break;
+    // };
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// latencyKind
+//
+// Event kind for the latency statistics
+//
+
+static int
+latencyKind(const vscpEvent* pev)
+{
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        if ((eventTypes[what].vscp_class == pev->vscp_class) &&
+            (eventTypes[what].vscp_type == pev->vscp_type)) {
+            return what;
+        }
+    }
+
+    if ((VSCP_CLASS2_VSCPD == pev->vscp_class) &&
+        (VSCP2_TYPE_VSCPD_NEW_CALCULATION == pev->vscp_type)) {
+        return AUTOMATION_LATENCY_CALC;
+    }
+
+    return AUTOMATION_LATENCY_OTHER;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// eventExToReceiveQueue
+//
+
+bool
+CAutomation::eventExToReceiveQueue(vscpEventEx& ex)
+{
+    return eventsExToReceiveQueue(&ex, 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// eventsExToReceiveQueue
+//
+
+bool
+CAutomation::eventsExToReceiveQueue(vscpEventEx* pex,
+                                    size_t cnt,
+                                    const time_t* pdeadline)
+{
+    bool rv = true;
+    size_t n = 0;
+    int64_t now = CLatencyHistogram::now();
+    int64_t enqueued = CLatencyHistogram::nowMonotonic();
+    struct timespec waitEnd;
+    const CFilterRules* prules = m_pFilterRules.load(std::memory_order_acquire);
+
+    if (NULL == pex) {
+        return false;
+    }
+
+    // The block policy waits at most the timeout for the whole batch
+    CSpscRing<vscpEvent*>::makeDeadline(waitEnd, m_receiveQueueTimeout);
+
+    for (size_t i = 0; i < cnt; i++) {
+
+        // Rejected events are never allocated
+        if (!prules->match(pex[i])) {
+            m_receiveFiltered++;
+            continue;
+        }
+
+        vscpEvent* pev = m_receivePool.allocFromEx(&pex[i]);
+        if (NULL == pev) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Unable to allocate event storage.");
+            rv = false;
+            continue;
+        }
+
+        eventPoolSlot* pslot = CEventPool::getSlot(pev);
+        pslot->enqueued = enqueued;
+        if (NULL != pdeadline) {
+            pslot->scheduled = (int64_t)pdeadline[i] * 1000000;
+            m_latency[AUTOMATION_STAGE_SCHEDULE][latencyKind(pev)].record(
+              now - pslot->scheduled);
+        }
+
+        if (!pushReceiveEvent(pev, waitEnd)) {
+            rv = false;
+            continue;
+        }
+
+        n++;
+    }
+
+    // One wakeup for the whole batch
+    if (n) {
+        m_receiveQueue.notify();
+
+        // Make the pollable descriptor readable
+        if (m_bReceiveFd.load()) {
+            uint64_t one = 1;
+            if (sizeof(one) != write(m_receiveFd, &one, sizeof(one))) {
+                syslog(LOG_ERR,
+                       "[vscpl2drv-automation] Failed to signal receive "
+                       "descriptor. errno=%d",
+                       errno);
+            }
+        }
+    }
+
+    return rv;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// coalesceKey
+//
+// Events with the same key replace each other in a full receive queue
+//
+
+static uint32_t
+coalesceKey(const vscpEvent* pev)
+{
+    return ((uint32_t)pev->vscp_class << 16) | pev->vscp_type;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// replaceQueuedEvent
+//
+// Give a queued event the content of a new one. The host may pop the
+// queued event at the same time, so it is claimed first and left alone
+// if the host got there before us. Worker thread only.
+//
+
+static bool
+replaceQueuedEvent(vscpEvent* pq, const vscpEvent* pev)
+{
+    eventPoolSlot* pqslot = CEventPool::getSlot(pq);
+    const eventPoolSlot* pslot =
+      CEventPool::getSlot(const_cast<vscpEvent*>(pev));
+
+    // The key is only written by this thread so it can be read even if
+    // the host owns the event by now
+    if (pqslot->key != pslot->key) {
+        return false;
+    }
+
+    uint32_t state = EVENTPOOL_SLOT_QUEUED;
+    if (!pqslot->qstate.compare_exchange_strong(state,
+                                                EVENTPOOL_SLOT_UPDATING,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // Copy all but the data pointer
+    uint8_t* pdata = pq->pdata;
+    memcpy(pq, pev, sizeof(vscpEvent));
+    pq->pdata = pdata;
+    memcpy(pdata, pev->pdata, pev->sizeData);
+    pqslot->scheduled = pslot->scheduled;
+    pqslot->enqueued = pslot->enqueued;
+
+    pqslot->qstate.store(EVENTPOOL_SLOT_QUEUED, std::memory_order_release);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pushReceiveEvent
+//
+
+bool
+CAutomation::pushReceiveEvent(vscpEvent* pev, const struct timespec& waitEnd)
+{
+    vscpEvent* pold;
+    size_t size = m_receiveQueue.size();
+    eventPoolSlot* pslot = CEventPool::getSlot(pev);
+
+    // Published to the host by the push
+    pslot->key = coalesceKey(pev);
+    pslot->qstate.store(EVENTPOOL_SLOT_QUEUED, std::memory_order_relaxed);
+
+    if (size >= m_receiveQueueSize) {
+
+        // Log once each time the queue runs full
+        if (!m_bReceiveQueueFull) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Receive queue full (%u events). "
+                   "Policy %d applied.",
+                   (unsigned)m_receiveQueueSize,
+                   m_receiveQueuePolicy);
+            m_bReceiveQueueFull = true;
+        }
+
+        switch (m_receiveQueuePolicy) {
+
+            case AUTOMATION_QUEUE_DROP_OLDEST:
+                // The host may read the oldest event at the same time
+                if (m_receiveQueue.dropOldest(pold)) {
+                    m_receivePool.release(pold);
+                    m_receiveDropped++;
+                }
+                break;
+
+            case AUTOMATION_QUEUE_COALESCE:
+                // The newest value takes the place of an unread event of
+                // the same class and type
+                if (m_receiveQueue.findQueued([pev](vscpEvent* pq) {
+                        return replaceQueuedEvent(pq, pev);
+                    })) {
+                    m_receivePool.release(pev);
+                    m_receiveCoalesced++;
+                    return true;
+                }
+                m_receivePool.release(pev);
+                m_receiveDropped++;
+                return false;
+
+            case AUTOMATION_QUEUE_BLOCK:
+                // A host parked in a read has not been told about the
+                // events queued so far in this batch
+                m_receiveQueue.notify();
+                if (!m_receiveQueue.waitRoom(m_receiveQueueSize, waitEnd)) {
+                    m_receivePool.release(pev);
+                    m_receiveDropped++;
+                    return false;
+                }
+                break;
+
+            case AUTOMATION_QUEUE_DROP_NEWEST:
+            default:
+                m_receivePool.release(pev);
+                m_receiveDropped++;
+                return false;
+        }
 
-    //     case HLO_USER_CALC_ASTRO:
-    //         doCalc();
-    //         break;
+    } else if (m_bReceiveQueueFull && (size < m_receiveQueueSize / 2)) {
+        m_bReceiveQueueFull = false;
+    }
 
-    //     default:
-    //         break;
-    // };
+    // The ring is at least as large as the limit
+    if (!m_receiveQueue.push(pev)) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Receive queue full. Event dropped.");
+        m_receivePool.release(pev);
+        m_receiveDropped++;
+        return false;
+    }
+
+    // Only the worker thread updates the high-water mark
+    size = m_receiveQueue.size();
+    if (size > m_receiveHighWater.load(std::memory_order_relaxed)) {
+        m_receiveHighWater.store(size, std::memory_order_relaxed);
+    }
 
     return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// eventExToReceiveQueue
+// popReceiveEvent
 //
 
 bool
-CAutomation::eventExToReceiveQueue(vscpEventEx& ex)
+CAutomation::popReceiveEvent(vscpEvent** ppEvent, uint32_t timeout)
 {
-    vscpEvent* pev = new vscpEvent();
-    if (vscp_convertEventExToEvent(pev, &ex)) {
-        syslog(LOG_ERR,
-               "[vscpl2drv-automation] Failed to convert event from ex to ev.");
-        vscp_deleteEvent(pev);
+    uint64_t cnt;
+
+    if (NULL == ppEvent) {
         return false;
     }
-    if (NULL != pev) {
-        if (vscp_doLevel2Filter(pev, &m_vscpfilter)) {
-            pthread_mutex_lock(&m_mutexReceiveQueue);
-            m_receiveList.push_back(pev);
-            sem_post(&m_semReceiveQueue);
-            pthread_mutex_unlock(&m_mutexReceiveQueue);
-        } else {
-            vscp_deleteEvent(pev);
+
+    if (!m_receiveQueue.popWait(*ppEvent, timeout)) {
+        return false;
+    }
+
+    // Wait while the worker thread replaces the content of a
+    // coalesced event
+    eventPoolSlot* pslot = CEventPool::getSlot(*ppEvent);
+    uint32_t state = EVENTPOOL_SLOT_QUEUED;
+    while (!pslot->qstate.compare_exchange_weak(state,
+                                                EVENTPOOL_SLOT_TAKEN,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+        if (EVENTPOOL_SLOT_UPDATING == state) {
+            sched_yield();
         }
-    } else {
-        syslog(LOG_ERR,
-               "[vscpl2drv-automation] Unable to allocate event storage.");
+        state = EVENTPOOL_SLOT_QUEUED;
+    }
+
+    // Time spent in the queue and since the event was due. The due
+    // time is wall clock time, the queue time is not affected by
+    // changes of the clock.
+    int kind = latencyKind(*ppEvent);
+    m_latency[AUTOMATION_STAGE_QUEUE][kind].record(
+      CLatencyHistogram::nowMonotonic() - pslot->enqueued);
+    if (pslot->scheduled) {
+        m_latency[AUTOMATION_STAGE_TOTAL][kind].record(
+          CLatencyHistogram::now() - pslot->scheduled);
+    }
+
+    // Clear the pollable descriptor when the queue runs empty. The queue
+    // is checked again after the clear as the worker thread may have
+    // added an event in between.
+    if (m_bReceiveFd.load() && m_receiveQueue.empty()) {
+        if ((-1 == read(m_receiveFd, &cnt, sizeof(cnt))) && (EAGAIN != errno)) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Failed to clear receive "
+                   "descriptor. errno=%d",
+                   errno);
+        }
+
+        if (!m_receiveQueue.empty()) {
+            cnt = 1;
+            if (sizeof(cnt) != write(m_receiveFd, &cnt, sizeof(cnt))) {
+                syslog(LOG_ERR,
+                       "[vscpl2drv-automation] Failed to signal receive "
+                       "descriptor. errno=%d",
+                       errno);
+            }
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getReceiveFd
+//
+
+int
+CAutomation::getReceiveFd(void)
+{
+    if (-1 == m_receiveFd) {
+        return -1;
+    }
+
+    if (!m_bReceiveFd.exchange(true)) {
+        // Events may already be waiting
+        if (!m_receiveQueue.empty()) {
+            uint64_t one = 1;
+            if (sizeof(one) != write(m_receiveFd, &one, sizeof(one))) {
+                syslog(LOG_ERR,
+                       "[vscpl2drv-automation] Failed to signal receive "
+                       "descriptor. errno=%d",
+                       errno);
+            }
+        }
+    }
+
+    return m_receiveFd;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// latencyToJson
+//
+
+static json
+latencyToJson(const CLatencyHistogram& h)
+{
+    json j;
+    j["count"] = h.getCount();
+    j["min"] = h.getMin();
+    j["mean"] = h.getMean();
+    j["p50"] = h.getPercentile(50);
+    j["p90"] = h.getPercentile(90);
+    j["p99"] = h.getPercentile(99);
+    j["p99.9"] = h.getPercentile(99.9);
+    j["max"] = h.getMax();
+    return j;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getStatistics
+//
+
+void
+CAutomation::getStatistics(std::string& str)
+{
+    const char* kindNames[AUTOMATION_LATENCY_KINDS];
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        kindNames[what] = eventTypes[what].name;
+    }
+    kindNames[AUTOMATION_LATENCY_CALC] = "calculation";
+    kindNames[AUTOMATION_LATENCY_OTHER] = "other";
+    static const char* stageNames[AUTOMATION_STAGES] = { "schedule",
+                                                         "queue",
+                                                         "total" };
+
+    json j;
+
+    // Each event kind and all of them for the instance
+    CLatencyHistogram all[AUTOMATION_STAGES];
+    for (int kind = 0; kind < AUTOMATION_LATENCY_KINDS; kind++) {
+        for (int stage = 0; stage < AUTOMATION_STAGES; stage++) {
+            j["latency"][kindNames[kind]][stageNames[stage]] =
+              latencyToJson(m_latency[stage][kind]);
+            all[stage].add(m_latency[stage][kind]);
+        }
+    }
+
+    for (int stage = 0; stage < AUTOMATION_STAGES; stage++) {
+        j["latency"]["all"][stageNames[stage]] = latencyToJson(all[stage]);
+    }
+
+    j["receive-pool"]["alloc"] = m_receivePool.getAllocCount();
+    j["receive-pool"]["release"] = m_receivePool.getReleaseCount();
+    j["receive-pool"]["slots"] = m_receivePool.getSlotCount();
+    static const char* policyNames[] = { "drop-newest",
+                                         "drop-oldest",
+                                         "coalesce",
+                                         "block" };
+    j["receive-queue"]["size"] = m_receiveQueue.size();
+    j["receive-queue"]["limit"] = m_receiveQueueSize;
+    j["receive-queue"]["policy"] = policyNames[m_receiveQueuePolicy];
+    j["receive-queue"]["high-water"] = m_receiveHighWater.load();
+    j["receive-queue"]["dropped"] = m_receiveDropped.load();
+    j["receive-queue"]["coalesced"] = m_receiveCoalesced.load();
+    j["receive-queue"]["filtered"] = m_receiveFiltered.load();
+    j["filter"]["rules"] = m_filterRuleCount.load();
+    j["filter"]["updates"] = m_filterGeneration.load();
+    j["catch-up"]["grace"] = m_catchupGrace;
+    j["catch-up"]["clock-jumps"] = m_clockJumps.load();
+    j["catch-up"]["late"] = m_lateEvents.load();
+    j["catch-up"]["missed"] = m_missedEvents.load();
+    j["send-pool"]["alloc"] = m_sendPool.getAllocCount();
+    j["send-pool"]["release"] = m_sendPool.getReleaseCount();
+    j["send-pool"]["slots"] = m_sendPool.getSlotCount();
+    j["send-batch"] = latencyToJson(m_sendBatch);
+    j["send-batch"]["full"] = m_sendBatchFull.load();
+
+    str = j.dump();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setEventTime
+//
+// Set the time of an event to the time it was scheduled for
+//
+
+static void
+setEventTime(vscpEventEx& ex, time_t deadline)
+{
+    struct timespec ts;
+    struct tm tm;
+
+    // The timestamp is a microsecond counter, move it back by the time
+    // passed since the deadline
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t late =
+      ((int64_t)ts.tv_sec - deadline) * 1000000 + ts.tv_nsec / 1000;
+    ex.timestamp = vscp_makeTimeStamp() - (uint32_t)late;
+
+    // Date and time is UTC
+    gmtime_r(&deadline, &tm);
+    ex.year = tm.tm_year + 1900;
+    ex.month = tm.tm_mon + 1;
+    ex.day = tm.tm_mday;
+    ex.hour = tm.tm_hour;
+    ex.minute = tm.tm_min;
+    ex.second = tm.tm_sec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stampEvent
+//
+// Fill in an event from a template and the time it was scheduled for
+//
+
+static void
+stampEvent(const eventTemplate& tmpl, time_t deadline, vscpEventEx& ex)
+{
+    ex.obid = 0;
+    ex.head = tmpl.head;
+    ex.vscp_class = tmpl.vscp_class;
+    ex.vscp_type = tmpl.vscp_type;
+    memcpy(ex.GUID, tmpl.GUID, sizeof(ex.GUID));
+    ex.sizeData = tmpl.sizeData;
+    memcpy(ex.data, tmpl.data, tmpl.sizeData);
+    setEventTime(ex, deadline);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// matchTemplate
+//
+
+static bool
+matchTemplate(const CFilterRules* prules, const eventTemplate& tmpl)
+{
+    return prules->match(CEventFilter::getPriority(tmpl.head),
+                         tmpl.vscp_class,
+                         tmpl.vscp_type,
+                         tmpl.GUID);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// buildEventTemplates
+//
+
+void
+CAutomation::buildEventTemplates(void)
+{
+    eventTemplate tmpl;
+
+    memset(&tmpl, 0, sizeof(tmpl));
+    m_guid.writeGUID(tmpl.GUID);
+
+    // Send VSCP_CLASS2_VSCPD, Type=30/VSCP2_TYPE_VSCPD_NEW_CALCULATION
+    m_calcTemplate = tmpl;
+    m_calcTemplate.vscp_class = VSCP_CLASS2_VSCPD;
+    m_calcTemplate.vscp_type = VSCP2_TYPE_VSCPD_NEW_CALCULATION;
+
+    tmpl.sizeData = 3;
+    tmpl.data[0] = 0;         // index
+    tmpl.data[1] = m_zone;    // zone
+    tmpl.data[2] = m_subzone; // subzone
+
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        m_eventTemplate[what] = tmpl;
+        m_eventTemplate[what].vscp_class = eventTypes[what].vscp_class;
+        m_eventTemplate[what].vscp_type = eventTypes[what].vscp_type;
+    }
+
+    // Events that can't pass the filter are not scheduled or built.
+    // The filter does not look at the data so this holds for the
+    // events of all sites.
+    m_templateGeneration = m_filterGeneration.load(std::memory_order_acquire);
+    const CFilterRules* prules = m_pFilterRules.load(std::memory_order_acquire);
+    m_calcTemplate.bSend = matchTemplate(prules, m_calcTemplate);
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        m_eventTemplate[what].bSend =
+          matchTemplate(prules, m_eventTemplate[what]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// isEventEnabled
+//
+
+bool
+CAutomation::isEventEnabled(int what)
+{
+    switch (what) {
+
+        case SITE_TIME_SUNRISE_TWILIGHT:
+            return m_bSunRiseTwilightEvent;
+
+        case SITE_TIME_SUNRISE:
+            return m_bSunRiseEvent;
+
+        case SITE_TIME_NOON:
+            return m_bCalculatedNoonEvent;
+
+        case SITE_TIME_SUNSET:
+            return m_bSunSetEvent;
+
+        case SITE_TIME_SUNSET_TWILIGHT:
+            return m_bSunSetTwilightEvent;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// makeDeadlineEvent
+//
+
+bool
+CAutomation::makeDeadlineEvent(uint16_t id, time_t deadline, vscpEventEx& ex)
+{
+    if (id >> AUTOMATION_DEADLINE_SITE_SHIFT) {
+        return makeSiteEvent((id >> AUTOMATION_DEADLINE_SITE_SHIFT) - 1,
+                             id & AUTOMATION_DEADLINE_WHAT_MASK,
+                             deadline,
+                             ex);
+    }
+
+    if (AUTOMATION_DEADLINE_CALC == id) {
+        // Calculate Sunrise/sunset parameters once a day. This
+        // also schedules the deadlines for the new day.
+        doCalc();
+        if (!m_calcTemplate.bSend) {
+            return false;
+        }
+        stampEvent(m_calcTemplate, deadline, ex);
+        return true;
+    }
+
+    for (int what = 0; what < SITE_TIME_COUNT; what++) {
+        if (eventTypes[what].id == id) {
+            if (!m_eventTemplate[what].bSend) {
+                return false;
+            }
+            m_solarSent[what] = time(NULL);
+            stampEvent(m_eventTemplate[what], deadline, ex);
+            return true;
+        }
+    }
+
+    syslog(LOG_ERR,
+           "[vscpl2drv-automation] Unknown deadline id %d",
+           (int)id);
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// makeSiteEvent
+//
+
+bool
+CAutomation::makeSiteEvent(size_t idx, int what, time_t deadline, vscpEventEx& ex)
+{
+    if ((idx >= m_sites.size()) || (what >= SITE_TIME_COUNT) ||
+        !m_eventTemplate[what].bSend) {
+        return false;
     }
+
+    stampEvent(m_eventTemplate[what], deadline, ex);
+    ex.data[1] = m_sites.getZone(idx);     // zone
+    ex.data[2] = m_sites.getSubzone(idx);  // subzone
+
     return true;
 }
 
@@ -1680,182 +2969,206 @@ CAutomation::eventExToReceiveQueue(vscpEventEx& ex)
 bool
 CAutomation::doWork(void)
 {
-    vscpEventEx ex;
-    std::string str;
-    vscpdatetime now = vscpdatetime::Now();
+    vscpEventEx exbatch[AUTOMATION_MAX_BATCH];
+    time_t deadlines[AUTOMATION_MAX_BATCH];
+    size_t cnt = 0;
+    size_t missed = 0;
+    schedEntry entry;
+    time_t next;
+    time_t now = time(NULL);
+
+    // New filter rules, events may have to be added or removed
+    if (m_filterGeneration.load(std::memory_order_acquire) !=
+        m_templateGeneration) {
+        buildEventTemplates();
+        scheduleDeadlines();
+    }
+
+    // Rule sets replaced before the ones loaded above are not used
+    freeRetiredFilterRules();
+
+    int64_t jump = m_scheduler.checkClock();
+    if ((jump >= AUTOMATION_CLOCK_JUMP * 1000000LL) ||
+        (jump <= -AUTOMATION_CLOCK_JUMP * 1000000LL)) {
+        clockJumped(now, jump);
+    }
+
+    // Collect all deadlines that are due. If there are more than
+    // fits in a batch the scheduler wakes us again right away.
+    while ((cnt < AUTOMATION_MAX_BATCH) && m_scheduler.popDue(now, &entry)) {
+
+        // Deadlines come in order. A recalculation from this
+        // deadline schedules the ones after it.
+        m_checkedUntil = entry.deadline - 1;
+
+        // Too late to be of use. The recalculation is always done.
+        time_t late = now - entry.deadline;
+        if ((late > (time_t)m_catchupGrace) &&
+            (AUTOMATION_DEADLINE_CALC != entry.id)) {
+            missed++;
+            continue;
+        }
+
+        if (makeDeadlineEvent(entry.id, entry.deadline, exbatch[cnt])) {
+            if (late > AUTOMATION_LATE) {
+                m_lateEvents++;
+            }
+            deadlines[cnt] = entry.deadline;
+            cnt++;
+        }
+    }
+
+    if (!m_scheduler.peekDeadline(&next) || (next > now)) {
+        m_checkedUntil = now;
+    }
+
+    if (missed) {
+        m_missedEvents += missed;
+        syslog(LOG_INFO,
+               "[vscpl2drv-automation] %u events more than %u seconds late "
+               "was not sent.",
+               (unsigned)missed,
+               (unsigned)m_catchupGrace);
+    }
+
+    if (!cnt) {
+        return false;
+    }
+
+    // Put events in receive queue
+    return eventsExToReceiveQueue(exbatch, cnt, deadlines);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// clockJumped
+//
+
+void
+CAutomation::clockJumped(time_t now, int64_t jump)
+{
+    m_clockJumps++;
+    syslog(LOG_INFO,
+           "[vscpl2drv-automation] Clock moved %lld seconds (clock set or "
+           "suspend).",
+           (long long)(jump / 1000000));
+
+    // Moving forward makes missed deadlines due, they are sent if
+    // within the grace time. A recalculation that was missed is due
+    // as well.
+    if (jump > 0) {
+        return;
+    }
 
-    // Calculate Sunrise/sunset parameters once a day
-    if (!m_bCalulationHasBeenDone && (0 == vscpdatetime::Now().getHour())) {
+    // Deadlines after the new time has not happened yet
+    if (m_checkedUntil >= now) {
+        m_checkedUntil = now - 1;
+    }
 
+    // Back to another day, the next recalculation is too far ahead
+    int year, month, day;
+    if (m_pTimezone->getLocalDate(now, &year, &month, &day) != m_calcDay) {
         doCalc();
-        m_bCalulationHasBeenDone = true;
-
-        int hours, minutes;
-        convert2HourMinute(getDayLength(), &hours, &minutes);
-
-        // Send VSCP_CLASS2_VSCPD, Type=30/VSCP2_TYPE_VSCPD_NEW_CALCULATION
-        ex.obid = 0;
-        ex.head = 0;
-        ex.timestamp = vscp_makeTimeStamp();
-        vscp_setEventExToNow(&ex); // Set time to current time
-        ex.vscp_class = VSCP_CLASS2_VSCPD;
-        ex.vscp_type = VSCP2_TYPE_VSCPD_NEW_CALCULATION;
-        ex.sizeData = 0;
-        m_guid.writeGUID(ex.GUID);
-
-        // Put event in receive queue
-        return eventExToReceiveQueue(ex);
-    }
-
-    // Trigger for next noon calculation
-    if (0 != vscpdatetime::Now().getHour()) {
-        m_bCalulationHasBeenDone = false;
-    }
-
-    // Sunrise Time
-    if ((now.getYear() == m_SunriseTime.getYear()) &&
-        (now.getMonth() == m_SunriseTime.getMonth()) &&
-        (now.getDay() == m_SunriseTime.getDay()) &&
-        (now.getHour() == m_SunriseTime.getHour()) &&
-        (now.getMinute() == m_SunriseTime.getMinute())) {
-
-        m_SunriseTime += SPAN24; // Add 24h's
-        m_SunriseTime_sent = vscpdatetime::Now();
-
-        // Send VSCP_CLASS1_INFORMATION, Type=44/VSCP_TYPE_INFORMATION_SUNRISE
-        ex.obid = 0;
-        ex.head = 0;
-        ex.timestamp = vscp_makeTimeStamp();
-        vscp_setEventExToNow(&ex); // Set time to current time
-        ex.vscp_class = VSCP_CLASS1_INFORMATION;
-        ex.vscp_type = VSCP_TYPE_INFORMATION_SUNRISE;
-        ex.sizeData = 3;
-        m_guid.writeGUID(ex.GUID);
-
-        ex.data[0] = 0;         // index
-        ex.data[1] = m_zone;    // zone
-        ex.data[2] = m_subzone; // subzone
-
-        // Put event in receive queue
-        return eventExToReceiveQueue(ex);
-    }
-
-    // Civil Twilight Sunrise Time
-    if ((now.getYear() == m_civilTwilightSunriseTime.getYear()) &&
-        (now.getMonth() == m_civilTwilightSunriseTime.getMonth()) &&
-        (now.getDay() == m_civilTwilightSunriseTime.getDay()) &&
-        (now.getHour() == m_civilTwilightSunriseTime.getHour()) &&
-        (now.getMinute() == m_civilTwilightSunriseTime.getMinute())) {
-
-        m_civilTwilightSunriseTime += SPAN24; // Add 24h's
-        m_civilTwilightSunriseTime_sent = vscpdatetime::Now();
-
-        // Send VSCP_CLASS1_INFORMATION,
-        // Type=52/VSCP_TYPE_INFORMATION_SUNRISE_TWILIGHT_START
-        ex.obid = 0;
-        ex.head = 0;
-        ex.timestamp = vscp_makeTimeStamp();
-        vscp_setEventExToNow(&ex); // Set time to current time
-        ex.vscp_class = VSCP_CLASS1_INFORMATION;
-        ex.vscp_type = VSCP_TYPE_INFORMATION_SUNRISE_TWILIGHT_START;
-        ex.sizeData = 3;
-        m_guid.writeGUID(ex.GUID);
-
-        ex.data[0] = 0;         // index
-        ex.data[1] = m_zone;    // zone
-        ex.data[2] = m_subzone; // subzone
-
-        // Put event in receive queue
-        return eventExToReceiveQueue(ex);
-    }
-
-    // Sunset Time
-    if ((now.getYear() == m_SunsetTime.getYear()) &&
-        (now.getMonth() == m_SunsetTime.getMonth()) &&
-        (now.getDay() == m_SunsetTime.getDay()) &&
-        (now.getHour() == m_SunsetTime.getHour()) &&
-        (now.getMinute() == m_SunsetTime.getMinute())) {
-
-        m_SunsetTime += SPAN24; // Add 24h's
-        m_SunsetTime_sent = vscpdatetime::Now();
-
-        // Send VSCP_CLASS1_INFORMATION, Type=45/VSCP_TYPE_INFORMATION_SUNSET
-        ex.obid = 0;
-        ex.head = 0;
-        ex.timestamp = vscp_makeTimeStamp();
-        vscp_setEventExToNow(&ex); // Set time to current time
-        ex.vscp_class = VSCP_CLASS1_INFORMATION;
-        ex.vscp_type = VSCP_TYPE_INFORMATION_SUNSET;
-        ex.sizeData = 3;
-        m_guid.writeGUID(ex.GUID);
-
-        ex.data[0] = 0;         // index
-        ex.data[1] = m_zone;    // zone
-        ex.data[2] = m_subzone; // subzone
-
-        // Put event in receive queue
-        return eventExToReceiveQueue(ex);
-    }
-
-    // Civil Twilight Sunset Time
-    if ((now.getYear() == m_civilTwilightSunsetTime.getYear()) &&
-        (now.getMonth() == m_civilTwilightSunsetTime.getMonth()) &&
-        (now.getDay() == m_civilTwilightSunsetTime.getDay()) &&
-        (now.getHour() == m_civilTwilightSunsetTime.getHour()) &&
-        (now.getMinute() == m_civilTwilightSunsetTime.getMinute())) {
-
-        m_civilTwilightSunsetTime += SPAN24; // Add 24h's
-        m_civilTwilightSunsetTime_sent = vscpdatetime::Now();
-
-        // Send VSCP_CLASS1_INFORMATION,
-        // Type=53/VSCP_TYPE_INFORMATION_SUNSET_TWILIGHT_START
-        ex.obid = 0;
-        ex.head = 0;
-        ex.timestamp = vscp_makeTimeStamp();
-        vscp_setEventExToNow(&ex); // Set time to current time
-        ex.vscp_class = VSCP_CLASS1_INFORMATION;
-        ex.vscp_type = VSCP_TYPE_INFORMATION_SUNSET_TWILIGHT_START;
-        ex.sizeData = 3;
-        m_guid.writeGUID(ex.GUID);
-
-        ex.data[0] = 0;         // index
-        ex.data[1] = m_zone;    // zone
-        ex.data[2] = m_subzone; // subzone
-
-        // Put event in receive queue
-        return eventExToReceiveQueue(ex);
-    }
-
-    // Noon Time
-    if ((now.getYear() == m_noonTime.getYear()) &&
-        (now.getMonth() == m_noonTime.getMonth()) &&
-        (now.getDay() == m_noonTime.getDay()) &&
-        (now.getHour() == m_noonTime.getHour()) &&
-        (now.getMinute() == m_noonTime.getMinute())) {
-
-        m_noonTime += SPAN24; // Add 24h's
-        m_noonTime_sent = vscpdatetime::Now();
-
-        // Send VSCP_CLASS1_INFORMATION,
-        // Type=58/VSCP_TYPE_INFORMATION_CALCULATED_NOON
-        ex.obid = 0;
-        ex.head = 0;
-        ex.timestamp = vscp_makeTimeStamp();
-        vscp_setEventExToNow(&ex); // Set time to current time
-        ex.vscp_class = VSCP_CLASS1_INFORMATION;
-        ex.vscp_type = VSCP_TYPE_INFORMATION_CALCULATED_NOON;
-        ex.sizeData = 3;
-        m_guid.writeGUID(ex.GUID);
-
-        ex.data[0] = 0;         // index
-        ex.data[1] = m_zone;    // zone
-        ex.data[2] = m_subzone; // subzone
-
-        // Put event in receive queue
-        return eventExToReceiveQueue(ex);
     }
+}
 
-    return false;
+///////////////////////////////////////////////////////////////////////////////
+// doSendEvents
+//
+
+bool
+CAutomation::doSendEvents(void)
+{
+    std::list<vscpEvent*> batch;
+    bool bMore;
+
+    // Take the whole queue if it fits in a batch, the rest is
+    // left for the next pass
+    pthread_mutex_lock(&m_mutexSendQueue);
+    if (m_sendList.size() <= AUTOMATION_MAX_SEND_BATCH) {
+        batch.swap(m_sendList);
+    } else {
+        std::list<vscpEvent*>::iterator it = m_sendList.begin();
+        std::advance(it, AUTOMATION_MAX_SEND_BATCH);
+        batch.splice(batch.end(), m_sendList, m_sendList.begin(), it);
+    }
+    bMore = !m_sendList.empty();
+    pthread_mutex_unlock(&m_mutexSendQueue);
+
+    if (batch.empty()) {
+        return false;
+    }
+
+    m_sendBatch.record(batch.size());
+    if (bMore) {
+        m_sendBatchFull++;
+    }
+
+    for (std::list<vscpEvent*>::iterator it = batch.begin();
+         it != batch.end();
+         ++it) {
+
+        vscpEvent* pEvent = *it;
+
+        // Only HLO object event is of interst to us
+        if ((VSCP_CLASS2_HLO == pEvent->vscp_class) &&
+            (VSCP2_TYPE_HLO_COMMAND == pEvent->vscp_type) &&
+            vscp_isSameGUID(m_guid.getGUID(), pEvent->GUID)) {
+            handleHLO(pEvent);
+        }
+
+        m_sendPool.release(pEvent);
+    }
+
+    return bMore;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// wakeWorker
+//
+
+void
+CAutomation::wakeWorker(uint64_t cnt)
+{
+    if (NULL != m_pExecutor) {
+        m_pExecutor->post(this);
+    } else {
+        m_scheduler.wakeup(cnt);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// runTask
+//
+
+time_t
+CAutomation::runTask(void)
+{
+    time_t deadline = 0;
+
+    doWork();
+
+    // Posts are merged so take all events that are waiting. If there
+    // are more than a batch we are run again right away, after the
+    // deadlines that are due.
+    if (doSendEvents()) {
+        return time(NULL);
+    }
+
+    // More than a batch may have been due, then the deadline is
+    // already passed and we are run again right away.
+    m_scheduler.peekDeadline(&deadline);
+
+    // The executor is not woken when the clock is set, look now
+    // and then so a step back is noticed. The check is kept on a
+    // fixed grid so the deadline handed to the executor stays the
+    // same from run to run and it does not have to requeue us.
+    time_t check =
+      (time(NULL) / AUTOMATION_CLOCK_CHECK + 1) * AUTOMATION_CLOCK_CHECK;
+    if (!deadline || (deadline > check)) {
+        deadline = check;
+    }
+
+    return deadline;
 }
 
 // ----------------------------------------------------------------------------
@@ -1867,11 +3180,45 @@ CAutomation::doWork(void)
 bool
 CAutomation::addEvent2SendQueue(const vscpEvent* pEvent)
 {
+    if (NULL == pEvent) {
+        return false;
+    }
+
+    return (1 == addEvents2SendQueue(&pEvent, 1));
+}
+
+//////////////////////////////////////////////////////////////////////
+// addEvents2SendQueue
+//
+
+size_t
+CAutomation::addEvents2SendQueue(const vscpEvent* const* ppEvents, size_t cnt)
+{
+    size_t n = 0;
+
+    if (NULL == ppEvents) {
+        return 0;
+    }
+
+    // The pool is allocated from under the send queue lock
     pthread_mutex_lock(&m_mutexSendQueue);
-    m_sendList.push_back((vscpEvent*)pEvent);
-    sem_post(&m_semSendQueue);
+    for (; n < cnt; n++) {
+        vscpEvent* pev = m_sendPool.allocCopy(ppEvents[n]);
+        if (NULL == pev) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Unable to allocate event storage.");
+            break;
+        }
+        m_sendList.push_back(pev);
+    }
     pthread_mutex_unlock(&m_mutexSendQueue);
-    return true;
+
+    // Wake the worker thread once for each event
+    if (n) {
+        wakeWorker(n);
+    }
+
+    return n;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1898,55 +3245,35 @@ workerThread(void* pData)
            ifname);
 #endif
 
-    // Do work at least once a second. Check incoming
+    // Sleep until next deadline. Check incoming
     // event right away.
     while (!pObj->m_bQuit) {
 
         // Do the automation work
         pObj->doWork();
 
-        // Check for incoming event
-        int rv;
-        if (-1 == (rv = vscp_sem_wait(&pObj->m_semSendQueue, 1000))) {    
+        // Wait for next deadline or incoming event
+        if (SCHEDULER_WAIT_ERROR == pObj->m_scheduler.wait()) {
             if (EINTR == errno) {
                 syslog(LOG_INFO,
                        "[vscpl2drv-automation] Interrupted by a signal "
                        "handler. Terminating.");
                 pObj->m_bQuit = true;
-            } else if (EINVAL == errno) {
-                syslog(
-                  LOG_ERR,
-                  "[vscpl2drv-automation] Invalid semaphore. Terminating.");
+            } else {
+                syslog(LOG_ERR,
+                       "[vscpl2drv-automation] Scheduler wait failed "
+                       "errno=%d. Terminating.",
+                       errno);
                 pObj->m_bQuit = true;
             }
         }
 
-        // Check if there is event(s) for us
-        if (pObj->m_sendList.size()) {
-
-            // Yes there are event/(s) in the queue
-            // Handle
-
-            pthread_mutex_lock(&pObj->m_mutexSendQueue);
-            vscpEvent* pEvent = pObj->m_sendList.front();
-            pObj->m_sendList.pop_front();
-            pthread_mutex_unlock(&pObj->m_mutexSendQueue);
-
-            if (NULL == pEvent) {
-                continue;
-            }
-
-            // Only HLO object event is of interst to us
-            if ((VSCP_CLASS2_HLO == pEvent->vscp_class) &&
-                (VSCP2_TYPE_HLO_COMMAND == pEvent->vscp_type) && 
-                vscp_isSameGUID(pObj->m_guid.getGUID(), pEvent->GUID) ) {
-                pObj->handleHLO(pEvent);
-            }
-
-            vscp_deleteEvent(pEvent);
-            pEvent = NULL;
-
-        } // event to send
+        // Check if there is event(s) for us. If more than a batch is
+        // waiting the next wait returns right away, after the deadlines
+        // that are due has been handled.
+        if (pObj->doSendEvents()) {
+            pObj->m_scheduler.wakeup();
+        }
 
     } // Outer loop
 
@@ -31,9 +31,11 @@
 
 #define _POSIX
 
+#include <atomic>
 #include <list>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <pthread.h>
 #include <semaphore.h>
@@ -51,6 +53,18 @@
 #include <json.hpp>  // Needs C++11  -std=c++11
 #include <mustache.hpp>
 
+#include "eventfilter.h"
+#include "eventpool.h"
+#include "executor.h"
+#include "latency.h"
+#include "solarcalc.h"
+#include "solarnoaa.h"
+#include "schedulefile.h"
+#include "scheduler.h"
+#include "sitetable.h"
+#include "spscring.h"
+#include "tzinfo.h"
+
 // https://github.com/nlohmann/json
 using json = nlohmann::json;
 
@@ -60,11 +74,97 @@ using namespace kainjow::mustache;
 #define HLO_USER_CALC_ASTRO     (HLO_OP_USER_DEFINED + 0)
 #define VSCP2_TYPE_VSCPD_NEW_CALCULATION    12      // TODO(akhe)  Remove
 
+// Scheduler deadline id's
+#define AUTOMATION_DEADLINE_CALC                0   // Daily recalculation
+#define AUTOMATION_DEADLINE_SUNRISE             1
+#define AUTOMATION_DEADLINE_SUNRISE_TWILIGHT    2
+#define AUTOMATION_DEADLINE_SUNSET              3
+#define AUTOMATION_DEADLINE_SUNSET_TWILIGHT     4
+#define AUTOMATION_DEADLINE_NOON                5
+
+// Deadline id's for sites. The low bits hold SITE_TIME_xxx and the
+// high bits the site index + 1. Id's for the instance itself have
+// zero in the high bits.
+#define AUTOMATION_DEADLINE_SITE_SHIFT          3
+#define AUTOMATION_DEADLINE_WHAT_MASK           0x07
+#define AUTOMATION_DEADLINE_SITE(idx, what)                                    \
+    ((uint16_t)((((idx) + 1) << AUTOMATION_DEADLINE_SITE_SHIFT) | (what)))
+
+// Max number of sites for one instance
+#define AUTOMATION_MAX_SITES                    8190
+
+// Max number of events emitted in one doWork pass
+#define AUTOMATION_MAX_BATCH                    8
+
+// Max number of events taken from the send queue in one go. Deadlines
+// are checked between batches.
+#define AUTOMATION_MAX_SEND_BATCH               64
+
+// Default max number of events waiting to be read by the host
+#define AUTOMATION_RECEIVE_QUEUE_SIZE           1024
+
+// Default time a blocked producer waits for room in the receive queue (ms)
+#define AUTOMATION_RECEIVE_QUEUE_TIMEOUT        100
+
+// What to do when the receive queue is full
+#define AUTOMATION_QUEUE_DROP_NEWEST            0   // Drop the new event
+#define AUTOMATION_QUEUE_DROP_OLDEST            1   // Drop the oldest unread event
+#define AUTOMATION_QUEUE_COALESCE               2   // Replace an unread event of same class/type
+#define AUTOMATION_QUEUE_BLOCK                  3   // Wait for room, then drop new
+
+// Default time a missed deadline is still sent after a stall, clock
+// step or suspend (seconds)
+#define AUTOMATION_CATCHUP_GRACE                600
+
+// Realtime clock movement against the monotonic clock that is taken
+// as a clock step or suspend (seconds)
+#define AUTOMATION_CLOCK_JUMP                   5
+
+// An event sent more than this after its deadline is late (seconds)
+#define AUTOMATION_LATE                         2
+
+// Max time between clock checks when served by the shared executor,
+// which has no wakeup when the clock is set (seconds)
+#define AUTOMATION_CLOCK_CHECK                  3600
+
+// Default number of threads in the shared executor
+#define AUTOMATION_SHARED_THREADS               1
+
+// Max payload of a prebuilt event (index, zone, subzone)
+#define AUTOMATION_TEMPLATE_DATA                3
+
+// Event kinds for latency statistics. Solar events use SITE_TIME_xxx.
+#define AUTOMATION_LATENCY_CALC                 SITE_TIME_COUNT
+#define AUTOMATION_LATENCY_OTHER                (SITE_TIME_COUNT + 1)
+#define AUTOMATION_LATENCY_KINDS                (SITE_TIME_COUNT + 2)
+
+// Latency stages
+#define AUTOMATION_STAGE_SCHEDULE               0   // Deadline to queued
+#define AUTOMATION_STAGE_QUEUE                  1   // Queued to read by host
+#define AUTOMATION_STAGE_TOTAL                  2   // Deadline to read by host
+#define AUTOMATION_STAGES                       3
+
+/*!
+    Prebuilt event. Everything but the time is filled in when the
+    configuration is loaded, an event is only stamped with the time
+    when it is sent.
+*/
+struct eventTemplate
+{
+    uint16_t head;
+    uint16_t vscp_class;
+    uint16_t vscp_type;
+    uint16_t sizeData;
+    uint8_t GUID[16];
+    uint8_t data[AUTOMATION_TEMPLATE_DATA];
+    bool bSend; // Passes the output filter
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Class that holds one VSCP automation object
 //
 
-class CAutomation
+class CAutomation : public CExecutorTask
 {
 
   public:
@@ -86,10 +186,28 @@ class CAutomation
     void close(void);
 
     /*!
-        Add event to send queue
+        Make host threads blocked in a read return at once. Called
+        before the driver waits for its users to go away on close.
+     */
+    void wakeReaders(void);
+
+    /*!
+        Add a copy of an event to the send queue
+        @param pEvent Event to add. Still owned by the caller.
+        @return true on success, false on failure
      */
     bool addEvent2SendQueue(const vscpEvent *pEvent);
 
+    /*!
+        Add copies of several events to the send queue. The queue
+        is locked once for all of them.
+        @param ppEvents Array of pointers to events. Still owned by
+                the caller.
+        @param cnt Number of events in the array
+        @return Number of events added
+     */
+    size_t addEvents2SendQueue(const vscpEvent *const *ppEvents, size_t cnt);
+
     /*!
         \return Greater than zero if Daylight Saving Time is in effect,
         zero if Daylight Saving Time is not in effect, and less than
@@ -105,54 +223,159 @@ class CAutomation
     /*!
 
     */
-    static double FNday(int y, int m, int d, float h);
+    static void convert2HourMinute(double floatTime,
+                                   int *pHours,
+                                   int *pMinutes);
 
     /*!
+        Calculate Sunset/Sunrice etc
+    */
+    void doCalc(void);
 
+    /*!
+        Feed the scheduler with the deadlines from the last
+        calculation and the deadline for the next recalculation
+        at midnight. Deadlines up to m_checkedUntil already has
+        been handled and are skipped.
     */
-    static double FNrange(double x);
+    void scheduleDeadlines(void);
 
     /*!
+        Handle a step of the realtime clock or a suspend. Missed
+        deadlines are already due so only a step back needs work.
+        @param now Current time
+        @param jump Clock movement in microseconds
+    */
+    void clockJumped(time_t now, int64_t jump);
+
+    /*!
+        Put event on receive queue and signal
+        that a new event is available
 
+        @param ex Event to send
+        @return true on success, false on failure
     */
-    static double f0(double lat, double declin);
+    bool eventExToReceiveQueue(vscpEventEx &ex);
 
     /*!
+        Put a batch of events on the receive queue. The events are
+        converted and filtered before the queue is locked and all
+        of them are added in one go.
+
+        @param pex Pointer to array of events to send
+        @param cnt Number of events in the array
+        @param pdeadline Time each event was due, used for the
+                latency statistics. NULL if not scheduled.
+        @return true on success, false if one or more events failed
+    */
+    bool eventsExToReceiveQueue(vscpEventEx *pex,
+                                size_t cnt,
+                                const time_t *pdeadline = NULL);
 
+    /*!
+        Get the next event for the host. Used by all the read
+        functions of the driver so the pollable receive descriptor
+        is kept in sync with the queue.
+
+        @param ppEvent Pointer that will get the event. The event
+                must be released to m_receivePool when used.
+        @param timeout Max time to wait in milliseconds, zero
+                for no wait.
+        @return true if an event was fetched, false on timeout
     */
-    static double f1(double lat, double declin);
+    bool popReceiveEvent(vscpEvent **ppEvent, uint32_t timeout);
 
     /*!
+        Add one event to the receive queue and apply the overflow
+        policy if the queue is full. Worker thread only.
+
+        @param pev Pointer to pooled event. Owned by the queue on
+                success, released to the pool if dropped.
+        @param waitEnd Time (CLOCK_MONOTONIC) when the
+                AUTOMATION_QUEUE_BLOCK policy stops waiting. Shared by
+                all events of a batch.
+        @return true if queued or coalesced, false if dropped
+    */
+    bool pushReceiveEvent(vscpEvent *pev, const struct timespec &waitEnd);
 
+    /*!
+        Get latency and pool statistics as JSON. Latencies are in
+        microseconds for each event kind and stage.
+        @param str String that will get the JSON object
     */
-    static double FNsun(double d);
+    void getStatistics(std::string &str);
 
     /*!
+        Get a file descriptor that is readable as long as there
+        are events waiting in the receive queue. The descriptor
+        is owned by the driver.
 
+        @return File descriptor or -1 on failure
     */
-    static void convert2HourMinute(double floatTime,
-                                   int *pHours,
-                                   int *pMinutes);
+    int getReceiveFd(void);
 
     /*!
-        Calculate Sunset/Sunrice etc
+        Build the event for a due deadline. The event time is
+        set to the deadline, not to the time it is sent.
+
+        @param id Deadline id (AUTOMATION_DEADLINE_xxx)
+        @param deadline Time the deadline was scheduled for
+        @param ex Event that will get the data
+        @return true if an event should be sent, false otherwise
     */
-    void doCalc(void);
+    bool makeDeadlineEvent(uint16_t id, time_t deadline, vscpEventEx &ex);
 
     /*!
-        Put event on receive queue and signal
-        that a new event is available
+        Build the event for a due site deadline
+        @param idx Site index
+        @param what SITE_TIME_xxx
+        @param deadline Time the deadline was scheduled for
+        @param ex Event that will get the data
+        @return true if an event should be sent, false otherwise
+    */
+    bool makeSiteEvent(size_t idx, int what, time_t deadline, vscpEventEx &ex);
 
-        @param ex Event to send
-        @return true on success, false on failure
+    /*!
+        Build the event templates from the GUID, zone, subzone and
+        filter of the instance. Must be called when they change.
     */
-    bool eventExToReceiveQueue(vscpEventEx &ex);
+    void buildEventTemplates(void);
 
     /*!
-        Do automation work
+        Check if an event of the instance is enabled
+        @param what SITE_TIME_xxx
+        @return true if the event should be sent
+    */
+    bool isEventEnabled(int what);
+
+    /*!
+        Do automation work for all due deadlines
+        @return true if one or more deadlines was due and handled
     */
     bool doWork(void);
 
+    /*!
+        Take the events waiting in the send queue, up to
+        AUTOMATION_MAX_SEND_BATCH, with one lock of the queue and
+        handle them
+        @return true if events are left in the queue
+    */
+    bool doSendEvents(void);
+
+    /*!
+        Wake the thread that serves this instance. This is the own
+        worker thread or the shared executor.
+        @param cnt Number of events added to the send queue
+    */
+    void wakeWorker(uint64_t cnt);
+
+    /*!
+        Run by the shared executor. Does the work of one worker
+        thread loop.
+        @return Next deadline or zero if there is none
+    */
+    virtual time_t runTask(void);
+
     /*!
         Svae configuration
     */
@@ -163,6 +386,71 @@ class CAutomation
     */
     bool doLoadConfig(void);
 
+    /*!
+        Get a time zone from the configuration
+        @param j JSON value, offset from UTC in hours or IANA name
+        @return Pointer to zone or NULL if invalid
+    */
+    const CTimeZone *getTimezoneConfig(json &j);
+
+    /*!
+        Get output filter rules from the configuration
+        @param j JSON array of rules
+        @return Pointer to compiled rules or NULL if invalid
+    */
+    CFilterRules *getFilterRulesConfig(json &j);
+
+    /*!
+        Use a new set of output filter rules. Can be called from any
+        thread, the worker picks up the rules on its next pass without
+        taking a lock. The old set is freed by the worker when it is
+        no longer used.
+        @param prules Compiled rules, owned by the object after the call
+    */
+    void setFilterRules(CFilterRules *prules);
+
+    /*!
+        Replace the output filter rules while the driver runs. Can be
+        called from any thread.
+        @param str JSON array of rules, same format as "filter-rules"
+                   in the configuration
+        @return true on success, false if the rules are invalid. The
+                rules in use are kept on failure.
+    */
+    bool loadFilterRules(const std::string &str);
+
+    /// Free rule sets replaced by setFilterRules, worker thread only
+    void freeRetiredFilterRules(void);
+
+    /*!
+        Add a site from its configuration
+        @param j JSON object for the site
+        @return true on success, false if the site is invalid
+    */
+    bool readSiteConfig(json &j);
+
+    /*!
+        Map the schedule file, generate it first if it is missing, out
+        of date or does not match the configuration.
+        @return true if a valid schedule is mapped
+    */
+    bool loadSchedule(void);
+
+    /*!
+        Get the input data for the schedule file
+        @param firstDay First day, days since 1970-01-01
+        @param dayCount Number of days
+        @param lat Will get latitude for each site
+        @param lon Will get longitude for each site
+        @param tz Will get time zone for each site and day
+        @return Configuration hash
+    */
+    uint64_t getScheduleInput(int32_t firstDay,
+                              uint32_t dayCount,
+                              std::vector<double> &lat,
+                              std::vector<double> &lon,
+                              std::vector<double> &tz);
+
     /*!
         Parse HLO
 
@@ -277,36 +565,68 @@ class CAutomation
     void disableAutomation(void) { m_bEnableAutomation = false; };
     bool isAutomationEnabled(void) { return m_bEnableAutomation; };
 
-    vscpdatetime &getLastCalculation(void) { return m_lastCalculation; };
+    /*!
+        Get a time as local date and time in the zone of the
+        instance. Times are held as seconds since the epoch and are
+        only converted here, for the API and HLO.
+        @param t Time in seconds since epoch, zero for none
+        @return Local date and time, zero date if t is zero
+    */
+    vscpdatetime getLocalDateTime(time_t t) const;
+
+    /// Time of the last calculation (seconds since epoch)
+    time_t getLastCalcTime(void) const { return m_lastCalcTime; };
 
-    vscpdatetime &getCivilTwilightSunriseTime(void)
+    /*!
+        Get a calculated time for today
+        @param what SITE_TIME_xxx
+        @return Time in seconds since epoch, zero if there is none
+    */
+    time_t getSolarTime(int what) const
     {
-        return m_civilTwilightSunriseTime;
+        return ((what < 0) || (what >= SITE_TIME_COUNT)) ? 0 : m_solarTime[what];
     };
-    vscpdatetime &getSentCivilTwilightSunriseTime(void)
+
+    /*!
+        Get the time an event was last sent
+        @param what SITE_TIME_xxx
+        @return Time in seconds since epoch, zero if never sent
+    */
+    time_t getSolarSent(int what) const
     {
-        return m_civilTwilightSunriseTime_sent;
+        return ((what < 0) || (what >= SITE_TIME_COUNT)) ? 0 : m_solarSent[what];
     };
 
-    vscpdatetime &getCalulatedNoonTime(void) { return m_noonTime; };
+    vscpdatetime getLastCalculation(void) { return getLocalDateTime(m_lastCalcTime); };
 
-    vscpdatetime &getSunriseTime(void) { return m_SunriseTime; };
-    vscpdatetime &getSentSunriseTime(void) { return m_SunriseTime_sent; };
+    vscpdatetime getCivilTwilightSunriseTime(void)
+    {
+        return getLocalDateTime(m_solarTime[SITE_TIME_SUNRISE_TWILIGHT]);
+    };
+    vscpdatetime getSentCivilTwilightSunriseTime(void)
+    {
+        return getLocalDateTime(m_solarSent[SITE_TIME_SUNRISE_TWILIGHT]);
+    };
+
+    vscpdatetime getCalulatedNoonTime(void) { return getLocalDateTime(m_solarTime[SITE_TIME_NOON]); };
 
-    vscpdatetime &getSunsetTime(void) { return m_SunsetTime; };
-    vscpdatetime &getSentSunsetTime(void) { return m_SunsetTime_sent; };
+    vscpdatetime getSunriseTime(void) { return getLocalDateTime(m_solarTime[SITE_TIME_SUNRISE]); };
+    vscpdatetime getSentSunriseTime(void) { return getLocalDateTime(m_solarSent[SITE_TIME_SUNRISE]); };
 
-    vscpdatetime &getCivilTwilightSunsetTime(void)
+    vscpdatetime getSunsetTime(void) { return getLocalDateTime(m_solarTime[SITE_TIME_SUNSET]); };
+    vscpdatetime getSentSunsetTime(void) { return getLocalDateTime(m_solarSent[SITE_TIME_SUNSET]); };
+
+    vscpdatetime getCivilTwilightSunsetTime(void)
     {
-        return m_civilTwilightSunsetTime;
+        return getLocalDateTime(m_solarTime[SITE_TIME_SUNSET_TWILIGHT]);
     };
-    vscpdatetime &getSentCivilTwilightSunsetTime(void)
+    vscpdatetime getSentCivilTwilightSunsetTime(void)
     {
-        return m_civilTwilightSunsetTime_sent;
+        return getLocalDateTime(m_solarSent[SITE_TIME_SUNSET_TWILIGHT]);
     };
 
-    vscpdatetime &getNoonTime(void) { return m_noonTime; };
-    vscpdatetime &getSentNoonTime(void) { return m_noonTime_sent; };
+    vscpdatetime getNoonTime(void) { return getLocalDateTime(m_solarTime[SITE_TIME_NOON]); };
+    vscpdatetime getSentNoonTime(void) { return getLocalDateTime(m_solarSent[SITE_TIME_NOON]); };
 
     double getLongitude(void) { return m_longitude; };
     double getLatitude(void) { return m_latitude; };
@@ -340,25 +660,25 @@ class CAutomation
     }
 
     bool isSendSunriseEvent(void) { return m_bSunRiseEvent; };
-    vscpdatetime &getSentSunriseEvent(void) { return m_SunriseTime_sent; };
+    vscpdatetime getSentSunriseEvent(void) { return getSentSunriseTime(); };
 
     bool isSendSunriseTwilightEvent(void) { return m_bSunRiseTwilightEvent; };
-    vscpdatetime &getSentSunriseTwilightEvent(void)
+    vscpdatetime getSentSunriseTwilightEvent(void)
     {
-        return m_civilTwilightSunriseTime_sent;
+        return getSentCivilTwilightSunriseTime();
     };
 
     bool isSendSunsetEvent(void) { return m_bSunSetEvent; };
-    vscpdatetime &getSentSunsetEvent(void) { return m_SunsetTime_sent; };
+    vscpdatetime getSentSunsetEvent(void) { return getSentSunsetTime(); };
 
     bool isSendSunsetTwilightEvent(void) { return m_bSunSetTwilightEvent; };
-    vscpdatetime &getSunsetTwilightEventSent(void)
+    vscpdatetime getSunsetTwilightEventSent(void)
     {
-        return m_civilTwilightSunsetTime_sent;
+        return getSentCivilTwilightSunsetTime();
     };
 
     bool isSendCalculatedNoonEvent(void) { return m_bCalculatedNoonEvent; };
-    vscpdatetime &getSentCalculatedNoonEvent(void) { return m_noonTime_sent; };
+    vscpdatetime getSentCalculatedNoonEvent(void) { return getSentNoonTime(); };
 
   public:
 
@@ -377,6 +697,21 @@ class CAutomation
     /// Incoming filter
     vscpEventFilter m_vscpfilter;
 
+    /// Output filter rules, the whole set is swapped on a change
+    std::atomic<CFilterRules *> m_pFilterRules;
+
+    /// Replaced rule sets waiting to be freed (lock-free stack)
+    std::atomic<CFilterRules *> m_pRetiredRules;
+
+    /// Incremented each time the rules are replaced
+    std::atomic<uint32_t> m_filterGeneration;
+
+    /// Number of rules in use, for statistics
+    std::atomic<uint32_t> m_filterRuleCount;
+
+    /// Rule generation the event templates was built for
+    uint32_t m_templateGeneration;
+
     /*!
         Path to configuration file
     */
@@ -391,18 +726,76 @@ class CAutomation
     /// Pointer to worker threads
     pthread_t m_threadWork;
 
+    /// Use the shared executor instead of an own worker thread
+    bool m_bSharedThread;
+
+    /// Number of executor threads if this instance starts the executor
+    int m_nSharedThreads;
+
+    /// Shared executor or NULL if the instance has its own thread
+    CExecutor *m_pExecutor;
+
     std::list<vscpEvent *> m_sendList;
-    std::list<vscpEvent *> m_receiveList;
 
     /*!
-      Event object to indicate that there is an event in the output queue
-     */
-    sem_t m_semSendQueue;
-    sem_t m_semReceiveQueue;
+        Events to the host. The worker thread is the only producer.
+        All read functions of the driver pop from it, also from
+        several host threads at once, so no lock is needed.
+    */
+    CSpscRing<vscpEvent *> m_receiveQueue;
+
+    /// Max number of events in the receive queue
+    uint32_t m_receiveQueueSize;
+
+    /// AUTOMATION_QUEUE_xxx used when the receive queue is full
+    int m_receiveQueuePolicy;
+
+    /// Max time to wait for room with AUTOMATION_QUEUE_BLOCK for a
+    /// batch of events (ms)
+    uint32_t m_receiveQueueTimeout;
+
+    /// True while the receive queue is full, used to log once per episode
+    bool m_bReceiveQueueFull;
+
+    // Receive queue counters
+    std::atomic<uint64_t> m_receiveDropped;
+    std::atomic<uint64_t> m_receiveCoalesced;
+    std::atomic<uint64_t> m_receiveFiltered;
+    std::atomic<uint64_t> m_receiveHighWater;
+
+    /*!
+        Storage for events to the host. Allocated by the worker
+        thread and released by VSCPRead.
+    */
+    CEventPool m_receivePool;
+
+    /*!
+        eventfd that is readable when the receive queue is non-empty.
+        Only maintained after it has been handed out with getReceiveFd.
+    */
+    int m_receiveFd;
+    std::atomic<bool> m_bReceiveFd;
+
+    /*!
+        Storage for events from the host. Allocated by VSCPWrite with
+        m_mutexSendQueue held and released by the worker thread.
+    */
+    CEventPool m_sendPool;
+
+    /// Number of events handled for each pass over the send queue
+    CLatencyHistogram m_sendBatch;
+
+    /// Passes that left events in the send queue
+    std::atomic<uint64_t> m_sendBatchFull;
+
+    /*!
+        Deadlines for the worker thread. The worker sleeps until the
+        next deadline or until an event is added to the send queue.
+    */
+    CScheduler m_scheduler;
 
     // Mutex to protect the output queue
     pthread_mutex_t m_mutexSendQueue;
-    pthread_mutex_t m_mutexReceiveQueue;
 
     bool m_bEnableAutomation;
 
@@ -418,6 +811,45 @@ class CAutomation
     /// Latitude for this server
     double m_latitude;
 
+    /// Time zone of the instance, default for the sites
+    const CTimeZone *m_pTimezone;
+
+    /// Calculated times today (SITE_TIME_xxx), zero if there is none
+    time_t m_solarTime[SITE_TIME_COUNT];
+
+    /// Time each event was last sent (SITE_TIME_xxx), zero if never
+    time_t m_solarSent[SITE_TIME_COUNT];
+
+    /// Prebuilt events of the instance (SITE_TIME_xxx)
+    eventTemplate m_eventTemplate[SITE_TIME_COUNT];
+
+    /// Prebuilt new calculation event
+    eventTemplate m_calcTemplate;
+
+    /// Additional locations handled by this instance
+    CSiteTable m_sites;
+
+    /// Sunrise/sunset algorithm, SOLAR_ENGINE_LEGACY or SOLAR_ENGINE_NOAA
+    int m_solarEngine;
+
+    /// Latency for each stage and event kind (AUTOMATION_LATENCY_xxx)
+    CLatencyHistogram m_latency[AUTOMATION_STAGES][AUTOMATION_LATENCY_KINDS];
+
+    /// Statistics are written here on close, empty if not used
+    std::string m_statisticsFile;
+
+    /// Path to precalculated schedule, empty if not used
+    std::string m_scheduleFile;
+
+    /// Number of days to generate in the schedule file
+    uint32_t m_scheduleDays;
+
+    /*!
+        Precalculated times. Site zero is the location of the
+        instance followed by m_sites.
+    */
+    CScheduleFile m_schedule;
+
   private:
     /*!
         Enable/disable the CLASS1.INFORMATION, Type=52 (Civil sunrise twilight
@@ -469,29 +901,23 @@ class CAutomation
 
     /*!
         Calculations done every 24 hours and at startup
+        (seconds since epoch)
     */
-    vscpdatetime m_lastCalculation;
+    time_t m_lastCalcTime;
 
-    vscpdatetime m_civilTwilightSunriseTime;
-    vscpdatetime m_civilTwilightSunriseTime_sent;
+    /// Local date of the last calculation as days since 1970-01-01
+    int32_t m_calcDay;
 
-    vscpdatetime m_SunriseTime;
-    vscpdatetime m_SunriseTime_sent;
+    /// All deadlines up to and including this time has been handled
+    time_t m_checkedUntil;
 
-    vscpdatetime m_SunsetTime;
-    vscpdatetime m_SunsetTime_sent;
+    /// Max time a missed deadline is still sent (seconds)
+    uint32_t m_catchupGrace;
 
-    vscpdatetime m_civilTwilightSunsetTime;
-    vscpdatetime m_civilTwilightSunsetTime_sent;
-
-    vscpdatetime m_noonTime;
-    vscpdatetime m_noonTime_sent;
-
-    /*!
-        Set to true when calculations has been done and
-        time is 12:00
-    */
-    bool m_bCalulationHasBeenDone;
+    // Catch-up counters
+    std::atomic<uint64_t> m_clockJumps;
+    std::atomic<uint64_t> m_lateEvents;
+    std::atomic<uint64_t> m_missedEvents;
 };
 
 #endif
\ No newline at end of file
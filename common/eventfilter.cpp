@@ -0,0 +1,236 @@
+// eventfilter.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <string.h>
+
+#include "eventfilter.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CEventFilter::CEventFilter(void)
+{
+    clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// clear
+//
+
+void
+CEventFilter::clear(void)
+{
+    m_bAcceptAll = true;
+    m_bGuid = false;
+    m_filterPriority = 0;
+    m_maskPriority = 0;
+    m_filterClass = 0;
+    m_maskClass = 0;
+    m_filterType = 0;
+    m_maskType = 0;
+    memset(m_filterGuid, 0, sizeof(m_filterGuid));
+    memset(m_maskGuid, 0, sizeof(m_maskGuid));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// set
+//
+
+void
+CEventFilter::set(const vscpEventFilter& filter)
+{
+    m_maskPriority = filter.mask_priority;
+    m_maskClass = filter.mask_class;
+    m_maskType = filter.mask_type;
+    memcpy(m_maskGuid, filter.mask_GUID, sizeof(m_maskGuid));
+
+    // Only bits in the mask are compared
+    m_filterPriority = filter.filter_priority & m_maskPriority;
+    m_filterClass = filter.filter_class & m_maskClass;
+    m_filterType = filter.filter_type & m_maskType;
+    memcpy(m_filterGuid, filter.filter_GUID, sizeof(m_filterGuid));
+    m_filterGuid[0] &= m_maskGuid[0];
+    m_filterGuid[1] &= m_maskGuid[1];
+
+    m_bGuid = m_maskGuid[0] || m_maskGuid[1];
+    m_bAcceptAll =
+      !m_bGuid && !m_maskPriority && !m_maskClass && !m_maskType;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CFilterRules
+//
+
+CFilterRules::CFilterRules(void)
+{
+    m_pnext = NULL;
+    m_bDefault = true;
+    m_bAcceptAll = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// add
+//
+
+bool
+CFilterRules::add(const vscpEventFilter& filter, bool bAllow)
+{
+    if (m_rules.size() >= FILTER_MAX_RULES) {
+        return false;
+    }
+
+    filterRule rule;
+    rule.filter.set(filter);
+    rule.bAllow = bAllow;
+    m_rules.push_back(rule);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compile
+//
+
+void
+CFilterRules::compile(void)
+{
+    m_classType.clear();
+    m_class.clear();
+    m_wide.clear();
+
+    // Classes and class/types named exactly by some rule
+    for (size_t i = 0; i < m_rules.size(); i++) {
+        const CEventFilter& filter = m_rules[i].filter;
+        if (!filter.isExactClass()) {
+            continue;
+        }
+        m_class[filter.getFilterClass()];
+        if (filter.isExactType()) {
+            m_classType[((uint32_t)filter.getFilterClass() << 16) |
+                        filter.getFilterType()];
+        }
+    }
+
+    // The rules that can match each of them, in order. A rule for an
+    // exact class/type can only match its own entry.
+    for (size_t i = 0; i < m_rules.size(); i++) {
+
+        const CEventFilter& filter = m_rules[i].filter;
+        bool bExact = filter.isExactClass() && filter.isExactType();
+
+        for (std::unordered_map<uint32_t, std::vector<uint16_t>>::iterator it =
+               m_classType.begin();
+             it != m_classType.end();
+             ++it) {
+            if (filter.matchClass(it->first >> 16) &&
+                filter.matchType(it->first & 0xffff)) {
+                it->second.push_back(i);
+            }
+        }
+
+        if (!bExact) {
+            for (std::unordered_map<uint16_t, std::vector<uint16_t>>::iterator
+                   it = m_class.begin();
+                 it != m_class.end();
+                 ++it) {
+                if (filter.matchClass(it->first)) {
+                    it->second.push_back(i);
+                }
+            }
+        }
+
+        if (!filter.isExactClass()) {
+            m_wide.push_back(i);
+        }
+    }
+
+    // Events that match no rule pass if there are only deny rules
+    m_bDefault = true;
+    for (size_t i = 0; i < m_rules.size(); i++) {
+        if (m_rules[i].bAllow) {
+            m_bDefault = false;
+            break;
+        }
+    }
+
+    m_bAcceptAll = m_rules.empty() ||
+                   (m_rules[0].bAllow && m_rules[0].filter.isAcceptAll());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// matchList
+//
+
+bool
+CFilterRules::matchList(const std::vector<uint16_t>& list,
+                        uint8_t priority,
+                        uint16_t vscp_class,
+                        uint16_t vscp_type,
+                        const uint8_t* pguid) const
+{
+    for (std::vector<uint16_t>::const_iterator it = list.begin();
+         it != list.end();
+         ++it) {
+        const filterRule& rule = m_rules[*it];
+        if (rule.filter.match(priority, vscp_class, vscp_type, pguid)) {
+            return rule.bAllow;
+        }
+    }
+
+    return m_bDefault;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// match
+//
+
+bool
+CFilterRules::match(uint8_t priority,
+                    uint16_t vscp_class,
+                    uint16_t vscp_type,
+                    const uint8_t* pguid) const
+{
+    if (m_bAcceptAll) {
+        return true;
+    }
+
+    std::unordered_map<uint32_t, std::vector<uint16_t>>::const_iterator it =
+      m_classType.find(((uint32_t)vscp_class << 16) | vscp_type);
+    if (m_classType.end() != it) {
+        return matchList(it->second, priority, vscp_class, vscp_type, pguid);
+    }
+
+    std::unordered_map<uint16_t, std::vector<uint16_t>>::const_iterator itc =
+      m_class.find(vscp_class);
+    if (m_class.end() != itc) {
+        return matchList(itc->second, priority, vscp_class, vscp_type, pguid);
+    }
+
+    return matchList(m_wide, priority, vscp_class, vscp_type, pguid);
+}
@@ -0,0 +1,278 @@
+// eventfilter.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_EVENTFILTER__INCLUDED_)
+#define VSCPAUTOMATION_EVENTFILTER__INCLUDED_
+
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vscp.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Compiled filter/mask pair
+//
+// Same result as vscp_doLevel2Filter() but taken apart when the filter is
+// set so a check is a few and/xor operations on the fields of an event.
+// The fields can be checked before an event is built and a filter that
+// lets everything through is a single test.
+//
+
+class CEventFilter
+{
+
+  public:
+    /// Constructor, lets all events through
+    CEventFilter(void);
+
+    /*!
+        Compile a filter/mask pair
+        @param filter Filter and mask to use
+    */
+    void set(const vscpEventFilter &filter);
+
+    /// Let all events through
+    void clear(void);
+
+    /// True if all events pass
+    bool isAcceptAll(void) const { return m_bAcceptAll; };
+
+    /*!
+        Check event fields against the filter
+        @param priority Priority (0-7)
+        @param vscp_class VSCP class
+        @param vscp_type VSCP type
+        @param pguid Pointer to 16 byte GUID
+        @return true if the event passes the filter
+    */
+    bool match(uint8_t priority,
+               uint16_t vscp_class,
+               uint16_t vscp_type,
+               const uint8_t *pguid) const
+    {
+        if (m_bAcceptAll) {
+            return true;
+        }
+
+        if (((vscp_class ^ m_filterClass) & m_maskClass) ||
+            ((vscp_type ^ m_filterType) & m_maskType) ||
+            ((priority ^ m_filterPriority) & m_maskPriority)) {
+            return false;
+        }
+
+        if (m_bGuid) {
+            uint64_t guid[2];
+            memcpy(guid, pguid, sizeof(guid));
+            if (((guid[0] ^ m_filterGuid[0]) & m_maskGuid[0]) ||
+                ((guid[1] ^ m_filterGuid[1]) & m_maskGuid[1])) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    /*!
+        Check an event against the filter
+        @param ex Event to check
+        @return true if the event passes the filter
+    */
+    bool match(const vscpEventEx &ex) const
+    {
+        return match(getPriority(ex.head), ex.vscp_class, ex.vscp_type, ex.GUID);
+    };
+
+    /*!
+        Check an event against the filter
+        @param pev Pointer to event to check
+        @return true if the event passes the filter
+    */
+    bool match(const vscpEvent *pev) const
+    {
+        return match(getPriority(pev->head), pev->vscp_class, pev->vscp_type, pev->GUID);
+    };
+
+    /// True if the class is the only one that can match
+    bool isExactClass(void) const { return (0xffff == m_maskClass); };
+
+    /// True if the type is the only one that can match
+    bool isExactType(void) const { return (0xffff == m_maskType); };
+
+    /// Check the class only
+    bool matchClass(uint16_t vscp_class) const
+    {
+        return !((vscp_class ^ m_filterClass) & m_maskClass);
+    };
+
+    /// Check the type only
+    bool matchType(uint16_t vscp_type) const
+    {
+        return !((vscp_type ^ m_filterType) & m_maskType);
+    };
+
+    /// Class to match, only meaningful for the bits in the mask
+    uint16_t getFilterClass(void) const { return m_filterClass; };
+
+    /// Type to match, only meaningful for the bits in the mask
+    uint16_t getFilterType(void) const { return m_filterType; };
+
+    /// Priority from the head of an event (bits 5-7)
+    static uint8_t getPriority(uint16_t head) { return (head >> 5) & 0x07; };
+
+  private:
+    /// True if the mask is all zero
+    bool m_bAcceptAll;
+
+    /// True if some bit of the GUID mask is set
+    bool m_bGuid;
+
+    uint8_t m_filterPriority;
+    uint8_t m_maskPriority;
+    uint16_t m_filterClass;
+    uint16_t m_maskClass;
+    uint16_t m_filterType;
+    uint16_t m_maskType;
+
+    // GUID as two words, same byte order as the event
+    uint64_t m_filterGuid[2];
+    uint64_t m_maskGuid[2];
+};
+
+// Max number of rules in a rule set
+#define FILTER_MAX_RULES 4096
+
+///////////////////////////////////////////////////////////////////////////////
+// Ordered list of allow/deny filter rules
+//
+// Rules are checked in order and the first rule that matches an event
+// decides. An event that matches no rule is let through only if there
+// are no allow rules.
+//
+// When the set is compiled the rules are indexed on class and type. Each
+// class/type (and each class) that some rule names exactly gets the list
+// of rules that can match it, rules with wider masks are only checked for
+// events not in the index. Checking an event is a hash lookup and a check
+// of the rules in its list, however many other rules there are.
+//
+// A compiled set is never changed, so it can be read by one thread while
+// another builds the next one.
+//
+
+class CFilterRules
+{
+
+  public:
+    /// Constructor, an empty set lets all events through
+    CFilterRules(void);
+
+    /*!
+        Add a rule at the end. compile() must be called when all
+        rules are added.
+        @param filter Filter and mask of the rule
+        @param bAllow True to let matching events through, false to
+                      stop them
+        @return true on success, false if there are too many rules
+    */
+    bool add(const vscpEventFilter &filter, bool bAllow);
+
+    /// Build the index
+    void compile(void);
+
+    /*!
+        Check event fields against the rules
+        @param priority Priority (0-7)
+        @param vscp_class VSCP class
+        @param vscp_type VSCP type
+        @param pguid Pointer to 16 byte GUID
+        @return true if the event should be let through
+    */
+    bool match(uint8_t priority,
+               uint16_t vscp_class,
+               uint16_t vscp_type,
+               const uint8_t *pguid) const;
+
+    /// Check an event against the rules
+    bool match(const vscpEventEx &ex) const
+    {
+        return match(CEventFilter::getPriority(ex.head), ex.vscp_class, ex.vscp_type, ex.GUID);
+    };
+
+    /// Check an event against the rules
+    bool match(const vscpEvent *pev) const
+    {
+        return match(CEventFilter::getPriority(pev->head), pev->vscp_class, pev->vscp_type, pev->GUID);
+    };
+
+    /// Number of rules
+    size_t size(void) const { return m_rules.size(); };
+
+    /// True if all events pass
+    bool isAcceptAll(void) const { return m_bAcceptAll; };
+
+    /// Link used while the set waits to be freed, owned by the user
+    CFilterRules *m_pnext;
+
+  private:
+    /// Check the rules in a list in order
+    bool matchList(const std::vector<uint16_t> &list,
+                   uint8_t priority,
+                   uint16_t vscp_class,
+                   uint16_t vscp_type,
+                   const uint8_t *pguid) const;
+
+  private:
+    // One rule
+    struct filterRule
+    {
+        CEventFilter filter;
+        bool bAllow;
+    };
+
+    /// All rules in order
+    std::vector<filterRule> m_rules;
+
+    /// Rules that can match a class/type (class << 16 | type)
+    std::unordered_map<uint32_t, std::vector<uint16_t>> m_classType;
+
+    /// Rules that can match a class for types not in m_classType
+    std::unordered_map<uint16_t, std::vector<uint16_t>> m_class;
+
+    /// Rules that can match classes not in m_class
+    std::vector<uint16_t> m_wide;
+
+    /// Result if no rule matches
+    bool m_bDefault;
+
+    /// True if all events pass
+    bool m_bAcceptAll;
+};
+
+#endif
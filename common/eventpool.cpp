@@ -0,0 +1,256 @@
+// eventpool.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <new>
+
+#include <string.h>
+#include <syslog.h>
+
+#include "eventpool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CEventPool::CEventPool(void)
+{
+    m_pfree = NULL;
+    m_preturned.store(NULL, std::memory_order_relaxed);
+    m_pslabs.store(NULL, std::memory_order_relaxed);
+    m_allocs.store(0, std::memory_order_relaxed);
+    m_releases.store(0, std::memory_order_relaxed);
+    m_heapAllocs.store(0, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Destructor
+//
+
+CEventPool::~CEventPool(void)
+{
+    eventPoolSlab* pslab = m_pslabs.load(std::memory_order_relaxed);
+    while (NULL != pslab) {
+        eventPoolSlab* pnext = pslab->pnext;
+        delete pslab;
+        pslab = pnext;
+    }
+
+    m_pslabs.store(NULL, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// grow
+//
+
+bool
+CEventPool::grow(void)
+{
+    eventPoolSlab* pslab = new (std::nothrow) eventPoolSlab;
+    if (NULL == pslab) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to allocate event pool storage.");
+        return false;
+    }
+
+    for (int i = 0; i < EVENTPOOL_SLAB_SLOTS; i++) {
+        eventPoolSlot* pslot = &pslab->slots[i];
+        pslot->ev.pdata = pslot->data;
+        pslot->bInUse.store(false, std::memory_order_relaxed);
+        pslot->pnext = m_pfree;
+        m_pfree = pslot;
+    }
+
+    // Only the allocating thread adds slabs. Published with release
+    // so owns() sees an initialized slab.
+    pslab->pnext = m_pslabs.load(std::memory_order_relaxed);
+    m_pslabs.store(pslab, std::memory_order_release);
+    m_heapAllocs.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// alloc
+//
+
+vscpEvent*
+CEventPool::alloc(void)
+{
+    if (NULL == m_pfree) {
+
+        // Take all slots released by other threads in one go. As
+        // the whole stack is taken there is no ABA problem.
+        m_pfree = m_preturned.exchange(NULL, std::memory_order_acquire);
+
+        if ((NULL == m_pfree) && !grow()) {
+            return NULL;
+        }
+    }
+
+    eventPoolSlot* pslot = m_pfree;
+    m_pfree = pslot->pnext;
+    m_allocs.fetch_add(1, std::memory_order_relaxed);
+
+    memset(&pslot->ev, 0, sizeof(vscpEvent));
+    pslot->ev.pdata = pslot->data;
+    pslot->scheduled = 0;
+    pslot->enqueued = 0;
+    pslot->key = 0;
+    pslot->qstate.store(EVENTPOOL_SLOT_TAKEN, std::memory_order_relaxed);
+    pslot->bInUse.store(true, std::memory_order_relaxed);
+
+    return &pslot->ev;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// allocFromEx
+//
+
+vscpEvent*
+CEventPool::allocFromEx(const vscpEventEx* pex)
+{
+    if (NULL == pex) {
+        return NULL;
+    }
+
+    vscpEvent* pev = alloc();
+    if (NULL == pev) {
+        return NULL;
+    }
+
+    pev->crc = pex->crc;
+    pev->obid = pex->obid;
+    pev->year = pex->year;
+    pev->month = pex->month;
+    pev->day = pex->day;
+    pev->hour = pex->hour;
+    pev->minute = pex->minute;
+    pev->second = pex->second;
+    pev->timestamp = pex->timestamp;
+    pev->head = pex->head;
+    pev->vscp_class = pex->vscp_class;
+    pev->vscp_type = pex->vscp_type;
+    memcpy(pev->GUID, pex->GUID, sizeof(pev->GUID));
+    pev->sizeData =
+      (pex->sizeData > VSCP_MAX_DATA) ? VSCP_MAX_DATA : pex->sizeData;
+    memcpy(pev->pdata, pex->data, pev->sizeData);
+
+    return pev;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// allocCopy
+//
+
+vscpEvent*
+CEventPool::allocCopy(const vscpEvent* pevsrc)
+{
+    if (NULL == pevsrc) {
+        return NULL;
+    }
+
+    vscpEvent* pev = alloc();
+    if (NULL == pev) {
+        return NULL;
+    }
+
+    // Copy all but the data pointer
+    uint8_t* pdata = pev->pdata;
+    memcpy(pev, pevsrc, sizeof(vscpEvent));
+    pev->pdata = pdata;
+
+    if (pev->sizeData > VSCP_MAX_DATA) {
+        pev->sizeData = VSCP_MAX_DATA;
+    }
+
+    if ((NULL == pevsrc->pdata) || !pev->sizeData) {
+        pev->sizeData = 0;
+    } else {
+        memcpy(pev->pdata, pevsrc->pdata, pev->sizeData);
+    }
+
+    return pev;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// release
+//
+
+bool
+CEventPool::release(vscpEvent* pev)
+{
+    if (NULL == pev) {
+        return false;
+    }
+
+    eventPoolSlot* pslot = reinterpret_cast<eventPoolSlot*>(pev);
+
+    // A slot released twice would be on the free list twice and
+    // handed out to two users
+    if (!pslot->bInUse.exchange(false, std::memory_order_acq_rel)) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Event released to pool twice.");
+        return false;
+    }
+
+    // Push on the lock-free return stack
+    eventPoolSlot* phead = m_preturned.load(std::memory_order_relaxed);
+    do {
+        pslot->pnext = phead;
+    } while (!m_preturned.compare_exchange_weak(
+      phead, pslot, std::memory_order_release, std::memory_order_relaxed));
+
+    m_releases.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// owns
+//
+
+bool
+CEventPool::owns(const vscpEvent* pev) const
+{
+    uintptr_t p = reinterpret_cast<uintptr_t>(pev);
+
+    for (const eventPoolSlab* pslab = m_pslabs.load(std::memory_order_acquire);
+         NULL != pslab;
+         pslab = pslab->pnext) {
+
+        uintptr_t first = reinterpret_cast<uintptr_t>(&pslab->slots[0]);
+        uintptr_t end =
+          reinterpret_cast<uintptr_t>(&pslab->slots[EVENTPOOL_SLAB_SLOTS]);
+        if ((p >= first) && (p < end)) {
+            // Must be the start of a slot
+            return (0 == ((p - first) % sizeof(eventPoolSlot)));
+        }
+    }
+
+    return false;
+}
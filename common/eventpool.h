@@ -0,0 +1,180 @@
+// eventpool.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_EVENTPOOL__INCLUDED_)
+#define VSCPAUTOMATION_EVENTPOOL__INCLUDED_
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include <vscp.h>
+
+// Number of event slots allocated at a time when the pool grows
+#define EVENTPOOL_SLAB_SLOTS 32
+
+// Queue state of a slot (eventPoolSlot::qstate)
+#define EVENTPOOL_SLOT_TAKEN    0 // Not queued or taken by the reader
+#define EVENTPOOL_SLOT_QUEUED   1 // Waiting in a queue
+#define EVENTPOOL_SLOT_UPDATING 2 // Content replaced by the queue producer
+
+/*!
+    One pooled event. The payload is stored inline so the
+    event and its data is one block. The event must be the
+    first member so a vscpEvent pointer can be turned back
+    into a slot.
+*/
+struct eventPoolSlot
+{
+    vscpEvent ev;
+    eventPoolSlot *pnext;
+    int64_t scheduled; // Time the event was due (us), zero if none
+    int64_t enqueued;  // Time the event was queued (us, CLOCK_MONOTONIC)
+    std::atomic<bool> bInUse; // Handed out and not yet released
+    uint32_t key;              // Set by the queue producer, used to coalesce
+    std::atomic<uint32_t> qstate; // EVENTPOOL_SLOT_xxx
+    uint8_t data[VSCP_MAX_DATA];
+};
+
+/*!
+    Slots allocated in one go when the pool grows. Slabs are
+    linked so the list can be walked while it grows.
+*/
+struct eventPoolSlab
+{
+    eventPoolSlot slots[EVENTPOOL_SLAB_SLOTS];
+    eventPoolSlab *pnext;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Pool of fixed size events
+//
+// Events are taken from a free list and handed back when used. The heap is
+// only touched when the pool has to grow so in steady state no allocations
+// are done per event.
+//
+// alloc() must be serialized by the caller (one allocating thread or a
+// lock held by the caller). release() and owns() can be called from any
+// thread.
+//
+
+class CEventPool
+{
+
+  public:
+    /// Constructor
+    CEventPool(void);
+
+    /// Destructor
+    ~CEventPool(void);
+
+    /*!
+        Get an empty event from the pool.
+        @return Pointer to event or NULL if out of memory.
+    */
+    vscpEvent *alloc(void);
+
+    /*!
+        Get an event from the pool and fill it from an ex event
+        @param pex Pointer to ex event to copy
+        @return Pointer to event or NULL if out of memory.
+    */
+    vscpEvent *allocFromEx(const vscpEventEx *pex);
+
+    /*!
+        Get an event from the pool and fill it with a copy of
+        another event.
+        @param pev Pointer to event to copy
+        @return Pointer to event or NULL if out of memory.
+    */
+    vscpEvent *allocCopy(const vscpEvent *pev);
+
+    /*!
+        Give an event back to the pool. The event must have been
+        allocated from this pool.
+        @param pev Pointer to event to release
+        @return true on success, false if the event is already
+                released
+    */
+    bool release(vscpEvent *pev);
+
+    /*!
+        Check if a pointer is an event of this pool. Used to check
+        events handed back by the host.
+        @param pev Pointer to check
+        @return true if pev points to a slot of this pool
+    */
+    bool owns(const vscpEvent *pev) const;
+
+    /*!
+        Get the slot of a pooled event, used to reach the timing
+        fields
+        @param pev Pointer to event allocated from a pool
+        @return Pointer to slot
+    */
+    static eventPoolSlot *getSlot(vscpEvent *pev)
+    {
+        return reinterpret_cast<eventPoolSlot *>(pev);
+    };
+
+    /// Number of events handed out
+    uint64_t getAllocCount(void) const { return m_allocs.load(std::memory_order_relaxed); };
+
+    /// Number of events handed back
+    uint64_t getReleaseCount(void) const { return m_releases.load(std::memory_order_relaxed); };
+
+    /// Number of heap allocations done by the pool
+    uint64_t getHeapAllocCount(void) const { return m_heapAllocs.load(std::memory_order_relaxed); };
+
+    /// Total number of slots owned by the pool
+    uint64_t getSlotCount(void) const
+    {
+        return m_heapAllocs.load(std::memory_order_relaxed) * EVENTPOOL_SLAB_SLOTS;
+    };
+
+  private:
+    /// Add a slab of slots to the free list
+    bool grow(void);
+
+  private:
+    /// Free slots, owned by the allocating thread
+    eventPoolSlot *m_pfree;
+
+    /// Slots released from other threads (lock-free stack)
+    std::atomic<eventPoolSlot *> m_preturned;
+
+    /// All slabs, newest first. Freed when the pool is destroyed
+    std::atomic<eventPoolSlab *> m_pslabs;
+
+    // Counters
+    std::atomic<uint64_t> m_allocs;
+    std::atomic<uint64_t> m_releases;
+    std::atomic<uint64_t> m_heapAllocs;
+};
+
+#endif
@@ -0,0 +1,396 @@
+// executor.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <algorithm>
+
+#include <errno.h>
+#include <syslog.h>
+
+#include "executor.h"
+
+// The shared executor and its reference count
+static pthread_mutex_t g_mutexExecutor = PTHREAD_MUTEX_INITIALIZER;
+static CExecutor *g_pExecutor = NULL;
+static int g_refExecutor = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// CExecutorTask
+//
+
+CExecutorTask::CExecutorTask(void)
+{
+    m_execDeadline = 0;
+    m_execGen = 0;
+    m_bExecAttached = false;
+    m_bExecQueued = false;
+    m_bExecRunning = false;
+    m_bExecPending = false;
+}
+
+CExecutorTask::~CExecutorTask(void)
+{
+    ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CExecutor::CExecutor(void)
+{
+    m_bQuit = false;
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_condWork, NULL);
+    pthread_cond_init(&m_condDone, NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Destructor
+//
+
+CExecutor::~CExecutor(void)
+{
+    pthread_cond_destroy(&m_condDone);
+    pthread_cond_destroy(&m_condWork);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// get
+//
+
+CExecutor *
+CExecutor::get(int nThreads)
+{
+    CExecutor *pExecutor;
+
+    pthread_mutex_lock(&g_mutexExecutor);
+
+    if (NULL == g_pExecutor) {
+
+        if (nThreads < 1) {
+            nThreads = 1;
+        } else if (nThreads > EXECUTOR_MAX_THREADS) {
+            nThreads = EXECUTOR_MAX_THREADS;
+        }
+
+        g_pExecutor = new CExecutor();
+        if (!g_pExecutor->start(nThreads)) {
+            delete g_pExecutor;
+            g_pExecutor = NULL;
+        }
+    }
+
+    if (NULL != g_pExecutor) {
+        g_refExecutor++;
+    }
+
+    pExecutor = g_pExecutor;
+
+    pthread_mutex_unlock(&g_mutexExecutor);
+
+    return pExecutor;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// put
+//
+
+void
+CExecutor::put(void)
+{
+    pthread_mutex_lock(&g_mutexExecutor);
+
+    if ((NULL != g_pExecutor) && (0 == --g_refExecutor)) {
+        g_pExecutor->stop();
+        delete g_pExecutor;
+        g_pExecutor = NULL;
+    }
+
+    pthread_mutex_unlock(&g_mutexExecutor);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// start
+//
+
+bool
+CExecutor::start(int nThreads)
+{
+    for (int i = 0; i < nThreads; i++) {
+
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, threadMain, this)) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Unable to start executor thread.");
+            break;
+        }
+
+        m_threads.push_back(tid);
+    }
+
+    if (m_threads.empty()) {
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stop
+//
+
+void
+CExecutor::stop(void)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_bQuit = true;
+    pthread_cond_broadcast(&m_condWork);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (std::vector<pthread_t>::iterator it = m_threads.begin();
+         it != m_threads.end();
+         ++it) {
+        pthread_join(*it, NULL);
+    }
+
+    m_threads.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// laterDeadline
+//
+
+bool
+CExecutor::laterDeadline(const execDeadline &a, const execDeadline &b)
+{
+    return a.deadline > b.deadline;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// enqueue
+//
+
+void
+CExecutor::enqueue(CExecutorTask *ptask)
+{
+    if (ptask->m_bExecRunning) {
+        // Run again when the current run is done
+        ptask->m_bExecPending = true;
+        return;
+    }
+
+    if (!ptask->m_bExecQueued) {
+        ptask->m_bExecQueued = true;
+        m_ready.push_back(ptask);
+        pthread_cond_signal(&m_condWork);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// add
+//
+
+void
+CExecutor::add(CExecutorTask *ptask)
+{
+    if (NULL == ptask) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    ptask->m_bExecAttached = true;
+    ptask->m_bExecPending = false;
+    ptask->m_execDeadline = 0;
+    enqueue(ptask);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// remove
+//
+
+void
+CExecutor::remove(CExecutorTask *ptask)
+{
+    if (NULL == ptask) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+
+    ptask->m_bExecAttached = false;
+    ptask->m_bExecPending = false;
+
+    if (ptask->m_bExecQueued) {
+        m_ready.erase(std::find(m_ready.begin(), m_ready.end(), ptask));
+        ptask->m_bExecQueued = false;
+    }
+
+    // The heap must not refer to the task when it is gone. This
+    // includes replaced deadlines that has not been popped yet.
+    for (size_t i = 0; i < m_heap.size();) {
+        if (m_heap[i].ptask == ptask) {
+            m_heap[i] = m_heap.back();
+            m_heap.pop_back();
+        } else {
+            i++;
+        }
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), laterDeadline);
+    ptask->m_execDeadline = 0;
+
+    while (ptask->m_bExecRunning) {
+        pthread_cond_wait(&m_condDone, &m_mutex);
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// post
+//
+
+void
+CExecutor::post(CExecutorTask *ptask)
+{
+    if (NULL == ptask) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    if (ptask->m_bExecAttached) {
+        enqueue(ptask);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// collectDue
+//
+
+void
+CExecutor::collectDue(time_t now)
+{
+    while (!m_heap.empty() && (m_heap.front().deadline <= now)) {
+
+        std::pop_heap(m_heap.begin(), m_heap.end(), laterDeadline);
+        execDeadline entry = m_heap.back();
+        m_heap.pop_back();
+
+        // Skip deadlines that has been replaced
+        if (entry.gen != entry.ptask->m_execGen) {
+            continue;
+        }
+
+        entry.ptask->m_execDeadline = 0;
+        enqueue(entry.ptask);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// run
+//
+
+void
+CExecutor::run(void)
+{
+    pthread_mutex_lock(&m_mutex);
+
+    while (!m_bQuit) {
+
+        collectDue(time(NULL));
+
+        if (m_ready.empty()) {
+
+            if (m_heap.empty()) {
+                pthread_cond_wait(&m_condWork, &m_mutex);
+            } else {
+                // Absolute wait on the realtime clock
+                struct timespec ts;
+                ts.tv_sec = m_heap.front().deadline;
+                ts.tv_nsec = 0;
+                pthread_cond_timedwait(&m_condWork, &m_mutex, &ts);
+            }
+
+            continue;
+        }
+
+        CExecutorTask *ptask = m_ready.front();
+        m_ready.pop_front();
+        ptask->m_bExecQueued = false;
+        ptask->m_bExecRunning = true;
+
+        pthread_mutex_unlock(&m_mutex);
+        time_t next = ptask->runTask();
+        pthread_mutex_lock(&m_mutex);
+
+        ptask->m_bExecRunning = false;
+
+        if (ptask->m_bExecAttached) {
+
+            // Only replace the deadline in the heap if it has changed
+            if (next != ptask->m_execDeadline) {
+                ptask->m_execGen++;
+                ptask->m_execDeadline = next;
+                if (next) {
+                    execDeadline entry;
+                    entry.deadline = next;
+                    entry.gen = ptask->m_execGen;
+                    entry.ptask = ptask;
+                    m_heap.push_back(entry);
+                    std::push_heap(m_heap.begin(), m_heap.end(), laterDeadline);
+                }
+            }
+
+            if (ptask->m_bExecPending) {
+                ptask->m_bExecPending = false;
+                enqueue(ptask);
+            }
+        }
+
+        pthread_cond_broadcast(&m_condDone);
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// threadMain
+//
+
+void *
+CExecutor::threadMain(void *pData)
+{
+    CExecutor *pExecutor = (CExecutor *)pData;
+    if (NULL != pExecutor) {
+        pExecutor->run();
+    }
+
+    return NULL;
+}
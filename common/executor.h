@@ -0,0 +1,179 @@
+// executor.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_EXECUTOR__INCLUDED_)
+#define VSCPAUTOMATION_EXECUTOR__INCLUDED_
+
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+// Max number of threads in the shared executor
+#define EXECUTOR_MAX_THREADS 16
+
+class CExecutor;
+
+///////////////////////////////////////////////////////////////////////////////
+// Work item run by the shared executor
+//
+// A task is run when its deadline is reached or when it has been posted.
+// A task is never run on more than one executor thread at a time so its
+// state need no locking against itself.
+//
+
+class CExecutorTask
+{
+
+  public:
+    CExecutorTask(void);
+    virtual ~CExecutorTask(void);
+
+    /*!
+        Do the work of the task
+        @return Absolute time (seconds since epoch) when the task should
+                run again or zero if it only should run when posted.
+    */
+    virtual time_t runTask(void) = 0;
+
+  private:
+    friend class CExecutor;
+
+    /// Deadline in the heap, zero if none
+    time_t m_execDeadline;
+
+    /// Bumped on reschedule, stale deadlines in the heap are skipped
+    uint32_t m_execGen;
+
+    bool m_bExecAttached; // Added to the executor
+    bool m_bExecQueued;   // In the ready queue
+    bool m_bExecRunning;  // Being run by an executor thread
+    bool m_bExecPending;  // Posted while running
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Process-wide executor
+//
+// A small number of threads share one deadline heap and run all tasks
+// added to it. Thread count and stack memory stay the same no matter how
+// many driver instances there are.
+//
+// The executor is reference counted. The first get() starts the threads
+// and the last put() stops them.
+//
+
+class CExecutor
+{
+
+  public:
+    /*!
+        Get the shared executor, start it if needed
+        @param nThreads Number of threads. Only used when the executor
+                is started.
+        @return Pointer to executor or NULL if it could not be started
+    */
+    static CExecutor *get(int nThreads);
+
+    /*!
+        Drop a reference taken with get(). The threads are stopped
+        when the last reference is dropped.
+    */
+    static void put(void);
+
+    /*!
+        Add a task and run it as soon as possible
+        @param ptask Task to add
+    */
+    void add(CExecutorTask *ptask);
+
+    /*!
+        Remove a task. Waits if the task is running. When this call
+        returns the task will not be run again.
+        @param ptask Task to remove
+    */
+    void remove(CExecutorTask *ptask);
+
+    /*!
+        Run a task as soon as possible. Can be called from any thread.
+        Posts for a task that is already waiting to run are merged.
+        @param ptask Task to run
+    */
+    void post(CExecutorTask *ptask);
+
+    /// Number of running executor threads
+    int getThreadCount(void) const { return (int)m_threads.size(); };
+
+  private:
+    CExecutor(void);
+    ~CExecutor(void);
+
+    bool start(int nThreads);
+    void stop(void);
+
+    /// Executor thread
+    static void *threadMain(void *pData);
+    void run(void);
+
+    /// Put a task in the ready queue, m_mutex held
+    void enqueue(CExecutorTask *ptask);
+
+    /// Move due tasks to the ready queue, m_mutex held
+    void collectDue(time_t now);
+
+  private:
+    struct execDeadline
+    {
+        time_t deadline;
+        uint32_t gen;
+        CExecutorTask *ptask;
+    };
+
+    static bool laterDeadline(const execDeadline &a, const execDeadline &b);
+
+    /// Min-heap of task deadlines
+    std::vector<execDeadline> m_heap;
+
+    /// Tasks ready to run
+    std::deque<CExecutorTask *> m_ready;
+
+    std::vector<pthread_t> m_threads;
+
+    bool m_bQuit;
+
+    pthread_mutex_t m_mutex;
+
+    /// Signalled when there is work or the earliest deadline changes
+    pthread_cond_t m_condWork;
+
+    /// Signalled when a task has finished running
+    pthread_cond_t m_condDone;
+};
+
+#endif
@@ -0,0 +1,362 @@
+// handletable.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_HANDLETABLE__INCLUDED_)
+#define VSCPAUTOMATION_HANDLETABLE__INCLUDED_
+
+#include <atomic>
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Max number of live handles. Must be a power of two.
+#define HANDLETABLE_SLOTS      1024
+#define HANDLETABLE_INDEX_BITS 10
+
+// Generation counter wraps within 20 bits so a handle fits in 31 bits
+#define HANDLETABLE_GEN_MASK 0xfffff
+
+///////////////////////////////////////////////////////////////////////////////
+// Table of driver handles
+//
+// Objects are stored in a fixed slot array. A handle is the slot index
+// plus a generation counter that is bumped each time the slot is freed,
+// so a stale handle never resolves to a new object.
+//
+// Lookup is lock-free. A caller pins the slot while it uses the object
+// and remove() waits until all pins are gone before it hands the object
+// back for deletion. add() and remove() are serialized by a mutex, the
+// wait for pins is done without it on a futex so other handles can be
+// opened and closed meanwhile. The caller of remove() can pass a function
+// that makes users blocked inside the object return, it is called after
+// the handle is invalidated and before the wait.
+//
+
+template<typename T>
+class CHandleTable
+{
+
+  public:
+    /// Called by remove() to wake users blocked inside the object
+    typedef void (*wakeFn)(T *pobj);
+
+    /// Constructor
+    CHandleTable(void)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+
+        for (int i = 0; i < HANDLETABLE_SLOTS; i++) {
+            m_slots[i].gen.store(1, std::memory_order_relaxed);
+            m_slots[i].pins.store(0, std::memory_order_relaxed);
+            m_slots[i].pobj.store(NULL, std::memory_order_relaxed);
+            m_slots[i].bRemoving = false;
+            m_slots[i].nextFree = i + 1;
+        }
+
+        m_freeHead = 0;
+    };
+
+    /*!
+        Add an object
+        @param pobj Object to add
+        @return Handle for the object or zero if the table is full
+    */
+    long add(T *pobj)
+    {
+        long h = 0;
+
+        pthread_mutex_lock(&m_mutex);
+
+        if (m_freeHead < HANDLETABLE_SLOTS) {
+            int idx = m_freeHead;
+            m_freeHead = m_slots[idx].nextFree;
+            m_slots[idx].pobj.store(pobj);
+            h = makeHandle(idx, m_slots[idx].gen.load());
+        }
+
+        pthread_mutex_unlock(&m_mutex);
+
+        return h;
+    };
+
+    /*!
+        Get the object for a handle and pin it. Every successful
+        acquire must be followed by a release of the same handle.
+        @param h Handle
+        @return Pointer to object or NULL if the handle is not valid
+    */
+    T *acquire(long h)
+    {
+        int idx;
+        uint32_t gen;
+
+        if (!splitHandle(h, &idx, &gen)) {
+            return NULL;
+        }
+
+        slot &s = m_slots[idx];
+
+        // Pin first and then check the generation. remove() does it in
+        // the opposite order so one of us will see the other.
+        s.pins.fetch_add(1);
+        T *pobj = s.pobj.load();
+        if ((s.gen.load() != gen) || (NULL == pobj)) {
+            unpin(idx, gen);
+            return NULL;
+        }
+
+        return pobj;
+    };
+
+    /*!
+        Unpin an object pinned by acquire
+        @param h Handle
+    */
+    void release(long h)
+    {
+        int idx;
+        uint32_t gen;
+
+        if (splitHandle(h, &idx, &gen)) {
+            unpin(idx, gen);
+        }
+    };
+
+    /*!
+        Remove an object. New lookups of the handle fail at once, the
+        call then waits until all current users have released it.
+        @param h Handle
+        @param pwake Function that wakes users blocked in the object
+                or NULL
+        @return Pointer to the removed object or NULL if the handle is
+                not valid. The caller owns the object.
+    */
+    T *remove(long h, wakeFn pwake = NULL)
+    {
+        int idx;
+        uint32_t gen;
+
+        if (!splitHandle(h, &idx, &gen)) {
+            return NULL;
+        }
+
+        pthread_mutex_lock(&m_mutex);
+
+        slot &s = m_slots[idx];
+        T *pobj = s.pobj.load();
+        if ((s.gen.load() != gen) || (NULL == pobj) || s.bRemoving) {
+            pthread_mutex_unlock(&m_mutex);
+            return NULL;
+        }
+
+        invalidateSlot(idx);
+
+        pthread_mutex_unlock(&m_mutex);
+
+        freeSlot(idx, pobj, pwake);
+
+        return pobj;
+    };
+
+    /*!
+        Remove any object in the table. Used to clean up when the
+        library is unloaded.
+        @param pwake Function that wakes users blocked in the object
+                or NULL
+        @return Pointer to a removed object or NULL if the table is empty.
+                The caller owns the object.
+    */
+    T *removeAny(wakeFn pwake = NULL)
+    {
+        T *pobj = NULL;
+        int idx;
+
+        pthread_mutex_lock(&m_mutex);
+
+        for (idx = 0; idx < HANDLETABLE_SLOTS; idx++) {
+            slot &s = m_slots[idx];
+            if (!s.bRemoving && (NULL != (pobj = s.pobj.load()))) {
+                invalidateSlot(idx);
+                break;
+            }
+            pobj = NULL;
+        }
+
+        pthread_mutex_unlock(&m_mutex);
+
+        if (NULL != pobj) {
+            freeSlot(idx, pobj, pwake);
+        }
+
+        return pobj;
+    };
+
+  private:
+    struct slot
+    {
+        std::atomic<uint32_t> gen; // Bumped each time the slot is freed
+        std::atomic<uint32_t> pins; // Number of callers using the object
+        std::atomic<T *> pobj;      // Object or NULL if free
+        bool bRemoving;             // Being removed, guarded by m_mutex
+        int nextFree;               // Free list link, guarded by m_mutex
+    };
+
+    static long makeHandle(int idx, uint32_t gen)
+    {
+        return (static_cast<long>(gen) << HANDLETABLE_INDEX_BITS) | idx;
+    };
+
+    static bool splitHandle(long h, int *pidx, uint32_t *pgen)
+    {
+        if (h <= 0) {
+            return false;
+        }
+
+        *pidx = static_cast<int>(h & (HANDLETABLE_SLOTS - 1));
+        *pgen = static_cast<uint32_t>(h >> HANDLETABLE_INDEX_BITS);
+        return true;
+    };
+
+    /// Make new lookups of a slot fail. Called with m_mutex held.
+    void invalidateSlot(int idx)
+    {
+        slot &s = m_slots[idx];
+
+        // Generation zero is never handed out so handles are never zero
+        uint32_t gen = (s.gen.load() + 1) & HANDLETABLE_GEN_MASK;
+        if (0 == gen) {
+            gen = 1;
+        }
+        s.gen.store(gen);
+        s.bRemoving = true;
+    };
+
+    /// Drop a pin. The last user of a slot that is being removed
+    /// wakes the remover.
+    void unpin(int idx, uint32_t gen)
+    {
+        slot &s = m_slots[idx];
+
+        // Pairs with invalidateSlot() and the pin check in freeSlot().
+        // Either we see the new generation or the remover sees the
+        // pin gone.
+        if ((1 == s.pins.fetch_sub(1)) && (s.gen.load() != gen)) {
+            syscall(SYS_futex,
+                    reinterpret_cast<uint32_t *>(&s.pins),
+                    FUTEX_WAKE_PRIVATE,
+                    INT_MAX,
+                    NULL,
+                    NULL,
+                    0);
+        }
+    };
+
+    /// Wake and wait for users of an invalidated slot and put it on the
+    /// free list. Called without m_mutex held.
+    void freeSlot(int idx, T *pobj, wakeFn pwake)
+    {
+        slot &s = m_slots[idx];
+        uint32_t pins;
+
+        // Users parked in a blocking call would otherwise hold their
+        // pin until the call times out
+        if (NULL != pwake) {
+            pwake(pobj);
+        }
+
+        // Returns at once (EAGAIN) if the count changed since it was read
+        while (0 != (pins = s.pins.load())) {
+            syscall(SYS_futex,
+                    reinterpret_cast<uint32_t *>(&s.pins),
+                    FUTEX_WAIT_PRIVATE,
+                    pins,
+                    NULL,
+                    NULL,
+                    0);
+        }
+
+        pthread_mutex_lock(&m_mutex);
+
+        s.pobj.store(NULL);
+        s.bRemoving = false;
+        s.nextFree = m_freeHead;
+        m_freeHead = idx;
+
+        pthread_mutex_unlock(&m_mutex);
+    };
+
+  private:
+    slot m_slots[HANDLETABLE_SLOTS];
+
+    /// First free slot, HANDLETABLE_SLOTS if the table is full
+    int m_freeHead;
+
+    /// Serializes add and remove
+    pthread_mutex_t m_mutex;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Pin for the lifetime of a scope
+//
+
+template<typename T>
+class CHandleRef
+{
+
+  public:
+    CHandleRef(CHandleTable<T> &table, long h)
+      : m_table(table)
+      , m_h(h)
+    {
+        m_pobj = m_table.acquire(h);
+    };
+
+    ~CHandleRef(void)
+    {
+        if (NULL != m_pobj) {
+            m_table.release(m_h);
+        }
+    };
+
+    /// Object or NULL if the handle was not valid
+    T *get(void) const { return m_pobj; };
+
+  private:
+    CHandleRef(const CHandleRef &);
+    CHandleRef &operator=(const CHandleRef &);
+
+    CHandleTable<T> &m_table;
+    long m_h;
+    T *m_pobj;
+};
+
+#endif
@@ -0,0 +1,239 @@
+// latency.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <limits.h>
+#include <time.h>
+
+#include "latency.h"
+
+// Largest recorded value
+#define LATENCY_MAX_VALUE ((((uint64_t)1) << LATENCY_MAX_BITS) - 1)
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CLatencyHistogram::CLatencyHistogram(void)
+{
+    reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reset
+//
+
+void
+CLatencyHistogram::reset(void)
+{
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(LLONG_MAX, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bucketIndex
+//
+
+int
+CLatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < 2 * LATENCY_SUB_COUNT) {
+        return (int)value;
+    }
+
+    // Position of highest bit decides the power of two, the bits
+    // below it the sub bucket
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - LATENCY_SUB_BITS;
+
+    return (shift + 1) * LATENCY_SUB_COUNT +
+           (int)((value >> shift) - LATENCY_SUB_COUNT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bucketHigh
+//
+
+int64_t
+CLatencyHistogram::bucketHigh(int idx)
+{
+    if (idx < 2 * LATENCY_SUB_COUNT) {
+        return idx;
+    }
+
+    int shift = idx / LATENCY_SUB_COUNT - 1;
+    int64_t sub = LATENCY_SUB_COUNT + idx % LATENCY_SUB_COUNT;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// record
+//
+
+void
+CLatencyHistogram::record(int64_t us)
+{
+    uint64_t value = (us < 0) ? 0 : (uint64_t)us;
+    if (value > LATENCY_MAX_VALUE) {
+        value = LATENCY_MAX_VALUE;
+    }
+
+    m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    int64_t cur = m_min.load(std::memory_order_relaxed);
+    while (((int64_t)value < cur) &&
+           !m_min.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+        ;
+
+    cur = m_max.load(std::memory_order_relaxed);
+    while (((int64_t)value > cur) &&
+           !m_max.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+        ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// add
+//
+
+void
+CLatencyHistogram::add(const CLatencyHistogram& other)
+{
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        uint64_t n = other.m_buckets[i].load(std::memory_order_relaxed);
+        if (n) {
+            m_buckets[i].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    m_count.fetch_add(other.m_count.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+    m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+
+    int64_t v = other.m_min.load(std::memory_order_relaxed);
+    if (v < m_min.load(std::memory_order_relaxed)) {
+        m_min.store(v, std::memory_order_relaxed);
+    }
+
+    v = other.m_max.load(std::memory_order_relaxed);
+    if (v > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(v, std::memory_order_relaxed);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getMin
+//
+
+int64_t
+CLatencyHistogram::getMin(void) const
+{
+    return getCount() ? m_min.load(std::memory_order_relaxed) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getMean
+//
+
+double
+CLatencyHistogram::getMean(void) const
+{
+    uint64_t cnt = getCount();
+    if (!cnt) {
+        return 0;
+    }
+
+    return (double)m_sum.load(std::memory_order_relaxed) / cnt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getPercentile
+//
+
+int64_t
+CLatencyHistogram::getPercentile(double percentile) const
+{
+    uint64_t cnt = getCount();
+    if (!cnt) {
+        return 0;
+    }
+
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+
+    // Number of values at or below the percentile, at least one
+    uint64_t target = (uint64_t)(percentile / 100.0 * cnt + 0.5);
+    if (!target) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            // Never report more than was actually recorded
+            int64_t high = bucketHigh(i);
+            return (high < getMax()) ? high : getMax();
+        }
+    }
+
+    return getMax();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// now
+//
+
+int64_t
+CLatencyHistogram::now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// nowMonotonic
+//
+
+int64_t
+CLatencyHistogram::nowMonotonic(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,123 @@
+// latency.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_LATENCY__INCLUDED_)
+#define VSCPAUTOMATION_LATENCY__INCLUDED_
+
+#include <atomic>
+
+#include <stdint.h>
+
+// Sub buckets for each power of two. 16 gives a resolution of 1/16
+// (about 6%) of the value.
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_COUNT (1 << LATENCY_SUB_BITS)
+
+// Largest value that can be recorded is 2^(LATENCY_MAX_BITS) - 1
+// microseconds (about 19 hours). Larger values are counted as the max.
+#define LATENCY_MAX_BITS 36
+
+#define LATENCY_BUCKETS                                                        \
+    ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT)
+
+///////////////////////////////////////////////////////////////////////////////
+// Latency histogram
+//
+// Records latencies in microseconds in log-linear buckets in the same way
+// as a HDR histogram: exact below 2 * LATENCY_SUB_COUNT and then
+// LATENCY_SUB_COUNT buckets for each power of two. Memory is fixed and
+// recording is a few atomic adds so it can be done from any thread
+// without a lock.
+//
+
+class CLatencyHistogram
+{
+
+  public:
+    /// Constructor
+    CLatencyHistogram(void);
+
+    /*!
+        Record a latency
+        @param us Latency in microseconds, negative values are
+                recorded as zero
+    */
+    void record(int64_t us);
+
+    /*!
+        Add all values from another histogram
+        @param other Histogram to add
+    */
+    void add(const CLatencyHistogram &other);
+
+    /// Remove all values
+    void reset(void);
+
+    /// Number of recorded values
+    uint64_t getCount(void) const { return m_count.load(std::memory_order_relaxed); };
+
+    /// Smallest recorded value, zero if none
+    int64_t getMin(void) const;
+
+    /// Largest recorded value, zero if none
+    int64_t getMax(void) const { return m_max.load(std::memory_order_relaxed); };
+
+    /// Mean of the recorded values, zero if none
+    double getMean(void) const;
+
+    /*!
+        Get a percentile
+        @param percentile Percentile 0-100
+        @return Highest value equivalent to the bucket where the
+                percentile is, zero if no values are recorded
+    */
+    int64_t getPercentile(double percentile) const;
+
+    /// Current time in microseconds since epoch (CLOCK_REALTIME)
+    static int64_t now(void);
+
+    /// Current time in microseconds (CLOCK_MONOTONIC). Used for
+    /// intervals that must not be affected by changes of the clock.
+    static int64_t nowMonotonic(void);
+
+  private:
+    /// Bucket for a value
+    static int bucketIndex(uint64_t value);
+
+    /// Highest value that goes in a bucket
+    static int64_t bucketHigh(int idx);
+
+  private:
+    std::atomic<uint64_t> m_buckets[LATENCY_BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<int64_t> m_min;
+    std::atomic<int64_t> m_max;
+};
+
+#endif
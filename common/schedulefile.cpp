@@ -0,0 +1,307 @@
+// schedulefile.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include "schedulefile.h"
+#include "solarbatch.h"
+#include "solarcalc.h"
+#include "solarnoaa.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CScheduleFile::CScheduleFile(void)
+{
+    m_pheader = NULL;
+    m_precords = NULL;
+    m_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Destructor
+//
+
+CScheduleFile::~CScheduleFile(void)
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hashAdd
+//
+
+uint64_t
+CScheduleFile::hashAdd(uint64_t hash, const void *pdata, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)pdata;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// open
+//
+
+bool
+CScheduleFile::open(const std::string &path,
+                    uint64_t configHash,
+                    size_t siteCount)
+{
+    struct stat st;
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (-1 == fd) {
+        return false;
+    }
+
+    if ((-1 == fstat(fd, &st)) ||
+        ((size_t)st.st_size < sizeof(scheduleFileHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == p) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to map schedule file [%s] "
+               "errno=%d",
+               path.c_str(),
+               errno);
+        return false;
+    }
+
+    const scheduleFileHeader *phdr = (const scheduleFileHeader *)p;
+    size_t recordBytes =
+      (size_t)phdr->siteCount * phdr->dayCount * sizeof(scheduleRecord);
+
+    if (memcmp(phdr->magic, SCHEDULEFILE_MAGIC, sizeof(SCHEDULEFILE_MAGIC)) ||
+        (SCHEDULEFILE_VERSION != phdr->version) ||
+        (sizeof(scheduleRecord) != phdr->recordSize) ||
+        (siteCount != phdr->siteCount) || (configHash != phdr->configHash) ||
+        ((size_t)st.st_size != sizeof(scheduleFileHeader) + recordBytes)) {
+        munmap(p, st.st_size);
+        return false;
+    }
+
+    const scheduleRecord *precords = (const scheduleRecord *)(phdr + 1);
+    if (phdr->checksum != hashAdd(hashInit(), precords, recordBytes)) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Schedule file [%s] has a bad checksum.",
+               path.c_str());
+        munmap(p, st.st_size);
+        return false;
+    }
+
+    m_pheader = phdr;
+    m_precords = precords;
+    m_size = st.st_size;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// readHeader
+//
+
+bool
+CScheduleFile::readHeader(const std::string &path, scheduleFileHeader *phdr)
+{
+    if (NULL == phdr) {
+        return false;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (-1 == fd) {
+        return false;
+    }
+
+    ssize_t n = read(fd, phdr, sizeof(scheduleFileHeader));
+    ::close(fd);
+
+    return ((ssize_t)sizeof(scheduleFileHeader) == n) &&
+           !memcmp(phdr->magic, SCHEDULEFILE_MAGIC, sizeof(SCHEDULEFILE_MAGIC));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// close
+//
+
+void
+CScheduleFile::close(void)
+{
+    if (NULL != m_pheader) {
+        munmap((void *)m_pheader, m_size);
+    }
+
+    m_pheader = NULL;
+    m_precords = NULL;
+    m_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getRecord
+//
+
+const scheduleRecord *
+CScheduleFile::getRecord(size_t site, int32_t day) const
+{
+    if ((NULL == m_pheader) || (site >= m_pheader->siteCount) ||
+        (day < m_pheader->firstDay) ||
+        ((uint32_t)(day - m_pheader->firstDay) >= m_pheader->dayCount)) {
+        return NULL;
+    }
+
+    return &m_precords[site * m_pheader->dayCount + (day - m_pheader->firstDay)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// generate
+//
+
+bool
+CScheduleFile::generate(const std::string &path,
+                        uint64_t configHash,
+                        int32_t firstDay,
+                        uint32_t dayCount,
+                        size_t siteCount,
+                        const double *platitude,
+                        const double *plongitude,
+                        const double *ptzone,
+                        int engine)
+{
+    size_t cnt = siteCount * dayCount;
+
+    if (!cnt || (NULL == platitude) || (NULL == plongitude) ||
+        (NULL == ptzone)) {
+        return false;
+    }
+
+    // Calculate all sites and days in one batch
+    std::vector<double> dayNumber(cnt), lat(cnt), lon(cnt);
+    for (size_t s = 0; s < siteCount; s++) {
+        for (uint32_t d = 0; d < dayCount; d++) {
+            // Days since 1970-01-01 to days since J2000
+            dayNumber[s * dayCount + d] = (double)(firstDay + d) - 10957.5;
+            lat[s * dayCount + d] = platitude[s];
+            lon[s * dayCount + d] = plongitude[s];
+        }
+    }
+
+    std::vector<double> t[SITE_TIME_COUNT];
+    std::vector<double> daylength(cnt), declination(cnt), maxAltitude(cnt);
+    for (int j = 0; j < SITE_TIME_COUNT; j++) {
+        t[j].resize(cnt);
+    }
+
+    solarBatchResult res;
+    res.psunrise = &t[SITE_TIME_SUNRISE][0];
+    res.psunset = &t[SITE_TIME_SUNSET][0];
+    res.ptwilightSunrise = &t[SITE_TIME_SUNRISE_TWILIGHT][0];
+    res.ptwilightSunset = &t[SITE_TIME_SUNSET_TWILIGHT][0];
+    res.pnoon = &t[SITE_TIME_NOON][0];
+    res.pdaylength = &daylength[0];
+    res.pdeclination = &declination[0];
+    res.pmaxAltitude = &maxAltitude[0];
+
+    if (SOLAR_ENGINE_NOAA == engine) {
+        solar_calculateNoaaBatch(
+          cnt, &dayNumber[0], &lat[0], &lon[0], ptzone, &res);
+    } else {
+        solar_calculateBatch(cnt, &dayNumber[0], &lat[0], &lon[0], ptzone, &res);
+    }
+
+    std::vector<scheduleRecord> records(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        for (int j = 0; j < SITE_TIME_COUNT; j++) {
+            records[i].time[j] = CSiteTable::toUtcSeconds(t[j][i], ptzone[i]);
+        }
+        records[i].daylength = (int32_t)(daylength[i] * 3600);
+        records[i].declination = (float)declination[i];
+    }
+
+    scheduleFileHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SCHEDULEFILE_MAGIC, sizeof(SCHEDULEFILE_MAGIC));
+    hdr.version = SCHEDULEFILE_VERSION;
+    hdr.recordSize = sizeof(scheduleRecord);
+    hdr.siteCount = siteCount;
+    hdr.dayCount = dayCount;
+    hdr.firstDay = firstDay;
+    hdr.configHash = configHash;
+    hdr.checksum =
+      hashAdd(hashInit(), &records[0], cnt * sizeof(scheduleRecord));
+
+    // Write to a temporary file and rename it in place
+    char tmpname[32];
+    snprintf(tmpname, sizeof(tmpname), ".tmp%d", (int)getpid());
+    std::string tmppath = path + tmpname;
+
+    FILE *fp = fopen(tmppath.c_str(), "wb");
+    if (NULL == fp) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to create schedule file [%s] "
+               "errno=%d",
+               tmppath.c_str(),
+               errno);
+        return false;
+    }
+
+    bool rv = (1 == fwrite(&hdr, sizeof(hdr), 1, fp)) &&
+              (cnt == fwrite(&records[0], sizeof(scheduleRecord), cnt, fp));
+    rv = (0 == fclose(fp)) && rv;
+
+    if (!rv || (0 != rename(tmppath.c_str(), path.c_str()))) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to write schedule file [%s] "
+               "errno=%d",
+               path.c_str(),
+               errno);
+        unlink(tmppath.c_str());
+        return false;
+    }
+
+    return true;
+}
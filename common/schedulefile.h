@@ -0,0 +1,177 @@
+// schedulefile.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SCHEDULEFILE__INCLUDED_)
+#define VSCPAUTOMATION_SCHEDULEFILE__INCLUDED_
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sitetable.h"
+
+#define SCHEDULEFILE_MAGIC   "VSCPSUN"
+#define SCHEDULEFILE_VERSION 2
+
+// Default number of days in a generated file
+#define SCHEDULEFILE_DEFAULT_DAYS 366
+
+/*!
+    File header. The file is a cache for the host it is generated
+    on so native byte order is used.
+*/
+struct scheduleFileHeader
+{
+    char magic[8];          // SCHEDULEFILE_MAGIC
+    uint32_t version;       // SCHEDULEFILE_VERSION
+    uint32_t recordSize;    // sizeof(scheduleRecord)
+    uint32_t siteCount;     // Number of sites
+    uint32_t dayCount;      // Number of days for each site
+    int32_t firstDay;       // First day, days since 1970-01-01
+    uint32_t reserved;
+    uint64_t configHash;    // Hash of the location/time zone data
+    uint64_t checksum;      // Hash of all records
+};
+
+/*!
+    Calculated data for one site and one day. Records are stored
+    site by site with dayCount records for each site.
+*/
+struct scheduleRecord
+{
+    int32_t time[SITE_TIME_COUNT]; // Seconds from UTC midnight or
+                                   // SITE_TIME_NONE, SITE_TIME_xxx
+    int32_t daylength;             // Length of day in seconds
+    float declination;             // Declination of the sun in degrees
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Precalculated solar schedule
+//
+// Solar times only depend on date and location so they are calculated
+// for a number of days ahead and stored in a file that is mapped into
+// memory. A lookup is an index into the mapped records. Processes on the
+// same host that use the same file share its pages.
+//
+// The header holds a hash of the locations and time zones used. The file
+// is not used if it does not match the current configuration.
+//
+
+class CScheduleFile
+{
+
+  public:
+    /// Constructor
+    CScheduleFile(void);
+
+    /// Destructor
+    ~CScheduleFile(void);
+
+    /*!
+        Map a schedule file
+        @param path Path to file
+        @param configHash Expected configuration hash
+        @param siteCount Expected number of sites
+        @return true if the file was mapped and is valid
+    */
+    bool open(const std::string &path, uint64_t configHash, size_t siteCount);
+
+    /// Unmap the file
+    void close(void);
+
+    /*!
+        Read the header of a schedule file without mapping it
+        @param path Path to file
+        @param phdr Pointer to header that get the data
+        @return true if a header was read
+    */
+    static bool readHeader(const std::string &path, scheduleFileHeader *phdr);
+
+    /// True if a file is mapped
+    bool isOpen(void) const { return (NULL != m_pheader); };
+
+    /*!
+        Generate a schedule file. The file is written under a temporary
+        name and renamed so readers never see a partial file.
+        @param path Path to file
+        @param configHash Configuration hash to store
+        @param firstDay First day, days since 1970-01-01
+        @param dayCount Number of days
+        @param siteCount Number of sites
+        @param platitude Latitude for each site
+        @param plongitude Longitude for each site
+        @param ptzone Offset from UTC in hours for each site and day
+                (siteCount * dayCount values, site by site)
+        @param engine SOLAR_ENGINE_LEGACY or SOLAR_ENGINE_NOAA
+        @return true on success
+    */
+    static bool generate(const std::string &path,
+                         uint64_t configHash,
+                         int32_t firstDay,
+                         uint32_t dayCount,
+                         size_t siteCount,
+                         const double *platitude,
+                         const double *plongitude,
+                         const double *ptzone,
+                         int engine);
+
+    /*!
+        Add data to a configuration hash (FNV-1a)
+        @param hash Current hash, start with hashInit()
+        @param pdata Data to add
+        @param size Size of data
+        @return New hash
+    */
+    static uint64_t hashAdd(uint64_t hash, const void *pdata, size_t size);
+
+    /// Initial value for a configuration hash
+    static uint64_t hashInit(void) { return 0xcbf29ce484222325ULL; };
+
+    /*!
+        Get the record for a site and day
+        @param site Site index
+        @param day Day, days since 1970-01-01
+        @return Pointer to record or NULL if the day is not in the file
+    */
+    const scheduleRecord *getRecord(size_t site, int32_t day) const;
+
+    /// First day in the file
+    int32_t getFirstDay(void) const { return m_pheader ? m_pheader->firstDay : 0; };
+
+    /// Number of days in the file
+    uint32_t getDayCount(void) const { return m_pheader ? m_pheader->dayCount : 0; };
+
+  private:
+    /// Mapped file
+    const scheduleFileHeader *m_pheader;
+    const scheduleRecord *m_precords;
+    size_t m_size;
+};
+
+#endif
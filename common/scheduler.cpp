@@ -0,0 +1,273 @@
+// scheduler.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <algorithm>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+
+// Heap order - earliest deadline on top
+static bool
+laterDeadline(const schedEntry& a, const schedEntry& b)
+{
+    return a.deadline > b.deadline;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CScheduler::CScheduler(void)
+{
+    m_timerfd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (-1 == m_timerfd) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to create scheduler timer. "
+               "errno=%d",
+               errno);
+    }
+
+    m_wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (-1 == m_wakefd) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to create scheduler wakeup "
+               "event. errno=%d",
+               errno);
+    }
+
+    m_clockOffset = getClockOffset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Destructor
+//
+
+CScheduler::~CScheduler(void)
+{
+    if (-1 != m_timerfd) {
+        ::close(m_timerfd);
+    }
+
+    if (-1 != m_wakefd) {
+        ::close(m_wakefd);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// addDeadline
+//
+
+void
+CScheduler::addDeadline(time_t deadline, uint16_t id)
+{
+    schedEntry entry;
+    entry.deadline = deadline;
+    entry.id = id;
+
+    m_heap.push_back(entry);
+    std::push_heap(m_heap.begin(), m_heap.end(), laterDeadline);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// clear
+//
+
+void
+CScheduler::clear(void)
+{
+    m_heap.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// peekDeadline
+//
+
+bool
+CScheduler::peekDeadline(time_t* pdeadline) const
+{
+    if (m_heap.empty()) {
+        return false;
+    }
+
+    if (NULL != pdeadline) {
+        *pdeadline = m_heap.front().deadline;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// popDue
+//
+
+bool
+CScheduler::popDue(time_t now, schedEntry* pentry)
+{
+    if (m_heap.empty() || (m_heap.front().deadline > now)) {
+        return false;
+    }
+
+    std::pop_heap(m_heap.begin(), m_heap.end(), laterDeadline);
+    if (NULL != pentry) {
+        *pentry = m_heap.back();
+    }
+    m_heap.pop_back();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// armTimer
+//
+
+bool
+CScheduler::armTimer(void)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    // A zero it_value disarms the timer
+    if (!m_heap.empty()) {
+        its.it_value.tv_sec = m_heap.front().deadline;
+        // A deadline of zero would disarm the timer
+        if (0 == its.it_value.tv_sec) {
+            its.it_value.tv_nsec = 1;
+        }
+    }
+
+    // Cancel the wait if the clock is set, deadlines may have to move
+    if (-1 == timerfd_settime(m_timerfd,
+                              TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                              &its,
+                              NULL)) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Failed to arm scheduler timer. "
+               "errno=%d",
+               errno);
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// wait
+//
+
+int
+CScheduler::wait(void)
+{
+    uint64_t cnt;
+
+    if (!armTimer()) {
+        return SCHEDULER_WAIT_ERROR;
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = m_wakefd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = m_timerfd;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    if (-1 == poll(fds, 2, -1)) {
+        return SCHEDULER_WAIT_ERROR;
+    }
+
+    // Wakeups have priority so incoming events are handled right away
+    if ((fds[0].revents & POLLIN) &&
+        (sizeof(cnt) == read(m_wakefd, &cnt, sizeof(cnt)))) {
+        return SCHEDULER_WAIT_WAKEUP;
+    }
+
+    if (fds[1].revents & POLLIN) {
+        // Clear expiration count
+        if (-1 == read(m_timerfd, &cnt, sizeof(cnt))) {
+            if (ECANCELED == errno) {
+                return SCHEDULER_WAIT_CLOCK;
+            }
+            if (EAGAIN != errno) {
+                return SCHEDULER_WAIT_ERROR;
+            }
+        }
+    }
+
+    return SCHEDULER_WAIT_DEADLINE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// wakeup
+//
+
+void
+CScheduler::wakeup(uint64_t cnt)
+{
+    if (sizeof(cnt) != write(m_wakefd, &cnt, sizeof(cnt))) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Failed to wake scheduler. errno=%d",
+               errno);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getClockOffset
+//
+
+int64_t
+CScheduler::getClockOffset(void)
+{
+    struct timespec rt, mono;
+
+    clock_gettime(CLOCK_REALTIME, &rt);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+
+    return ((int64_t)rt.tv_sec - mono.tv_sec) * 1000000 +
+           (rt.tv_nsec - mono.tv_nsec) / 1000;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// checkClock
+//
+
+int64_t
+CScheduler::checkClock(void)
+{
+    int64_t offset = getClockOffset();
+    int64_t jump = offset - m_clockOffset;
+
+    m_clockOffset = offset;
+    return jump;
+}
@@ -0,0 +1,154 @@
+// scheduler.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SCHEDULER__INCLUDED_)
+#define VSCPAUTOMATION_SCHEDULER__INCLUDED_
+
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+// Return codes for CScheduler::wait
+#define SCHEDULER_WAIT_DEADLINE 0 // A deadline has been reached
+#define SCHEDULER_WAIT_WAKEUP   1 // Woken up by wakeup()
+#define SCHEDULER_WAIT_CLOCK    2 // The realtime clock was set
+#define SCHEDULER_WAIT_ERROR    -1 // Wait failed, errno is set
+
+/*!
+    One scheduled item. The id is owned by the user of the
+    scheduler and is handed back when the deadline is due.
+*/
+struct schedEntry
+{
+    time_t deadline; // Absolute time (seconds since epoch)
+    uint16_t id;     // User defined id for the deadline
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Deadline scheduler
+//
+// Absolute deadlines are held in a min-heap. The owning thread sleeps in
+// wait() until the earliest deadline is reached or until some other thread
+// calls wakeup(). The heap is only touched from the owning thread, wakeup()
+// can be called from any thread.
+//
+// Deadlines are on the realtime clock. A sleep is cut short if the clock
+// is set, and checkClock() tells how far the realtime clock has moved
+// against the monotonic clock, which also covers time spent in suspend.
+//
+
+class CScheduler
+{
+
+  public:
+    /// Constructor
+    CScheduler(void);
+
+    /// Destructor
+    ~CScheduler(void);
+
+    /*!
+        Add a deadline
+        @param deadline Absolute time in seconds since epoch
+        @param id User id returned when the deadline is due
+    */
+    void addDeadline(time_t deadline, uint16_t id);
+
+    /*!
+        Remove all deadlines
+    */
+    void clear(void);
+
+    /*!
+        Get the earliest deadline
+        @param pdeadline Pointer to variable that will get the deadline
+        @return true if there is a deadline, false if the heap is empty
+    */
+    bool peekDeadline(time_t *pdeadline) const;
+
+    /*!
+        Pop the earliest deadline if it is due
+        @param now Current time in seconds since epoch
+        @param pentry Pointer to entry that will get the due item
+        @return true if an item was due and popped, false otherwise
+    */
+    bool popDue(time_t now, schedEntry *pentry);
+
+    /*!
+        Sleep until the earliest deadline is reached, until
+        wakeup() is called from another thread or until the
+        realtime clock is set.
+        @return SCHEDULER_WAIT_DEADLINE, SCHEDULER_WAIT_WAKEUP,
+                SCHEDULER_WAIT_CLOCK or SCHEDULER_WAIT_ERROR
+    */
+    int wait(void);
+
+    /*!
+        Wake the thread sleeping in wait(). Wakeups posted before
+        the thread wakes are merged into one SCHEDULER_WAIT_WAKEUP
+        return from wait().
+        @param cnt Number of wakeups to post
+    */
+    void wakeup(uint64_t cnt = 1);
+
+    /*!
+        Check for a discontinuity of the realtime clock since the last
+        call. Steps of the clock and suspend both move the realtime
+        clock against the monotonic clock.
+        @return Realtime clock movement in microseconds not explained
+                by the monotonic clock. Positive if the clock moved
+                forward.
+    */
+    int64_t checkClock(void);
+
+    /// Number of scheduled deadlines
+    size_t size(void) const { return m_heap.size(); };
+
+  private:
+    /// Arm the timer with the earliest deadline (or disarm it)
+    bool armTimer(void);
+
+    /// Realtime minus monotonic clock in microseconds
+    static int64_t getClockOffset(void);
+
+  private:
+    /// Min-heap of deadlines
+    std::vector<schedEntry> m_heap;
+
+    /// timerfd for absolute deadline (CLOCK_REALTIME)
+    int m_timerfd;
+
+    /// eventfd used to wake the sleeping thread
+    int m_wakefd;
+
+    /// Clock offset at the last checkClock()
+    int64_t m_clockOffset;
+};
+
+#endif
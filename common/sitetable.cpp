@@ -0,0 +1,239 @@
+// sitetable.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <math.h>
+#include <string.h>
+
+#include "schedulefile.h"
+#include "solarbatch.h"
+#include "solarcalc.h"
+#include "solarnoaa.h"
+#include "solartable.h"
+#include "sitetable.h"
+#include "tzinfo.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CSiteTable::CSiteTable(void)
+{
+    m_dayBase = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// addSite
+//
+
+size_t
+CSiteTable::addSite(double latitude,
+                    double longitude,
+                    const CTimeZone* ptz,
+                    uint8_t zone,
+                    uint8_t subzone,
+                    uint8_t enable)
+{
+    m_latitude.push_back(latitude);
+    m_longitude.push_back(longitude);
+    m_tz.push_back(ptz);
+    m_zone.push_back(zone);
+    m_subzone.push_back(subzone);
+    m_enable.push_back(enable & SITE_ENABLE_ALL);
+
+    for (int d = 0; d < SITE_DAYS; d++) {
+        for (int i = 0; i < SITE_TIME_COUNT; i++) {
+            m_time[d][i].push_back(SITE_TIME_NONE);
+        }
+    }
+
+    return m_latitude.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// clear
+//
+
+void
+CSiteTable::clear(void)
+{
+    m_latitude.clear();
+    m_longitude.clear();
+    m_tz.clear();
+    m_zone.clear();
+    m_subzone.clear();
+    m_enable.clear();
+
+    for (int d = 0; d < SITE_DAYS; d++) {
+        for (int i = 0; i < SITE_TIME_COUNT; i++) {
+            m_time[d][i].clear();
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getFirstDay
+//
+
+int32_t
+CSiteTable::getFirstDay(size_t idx) const
+{
+    int year, month, day;
+    return m_tz[idx]->getLocalDate(m_dayBase, &year, &month, &day);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadSchedule
+//
+
+bool
+CSiteTable::loadSchedule(const CScheduleFile& schedule,
+                         size_t firstSite,
+                         time_t dayStart)
+{
+    time_t oldBase = m_dayBase;
+    m_dayBase = dayStart;
+
+    size_t cnt = m_latitude.size();
+    for (size_t i = 0; i < cnt; i++) {
+        int32_t firstDay = getFirstDay(i);
+        for (int d = 0; d < SITE_DAYS; d++) {
+            const scheduleRecord* prec =
+              schedule.getRecord(firstSite + i, firstDay + d);
+            if (NULL == prec) {
+                m_dayBase = oldBase;
+                return false;
+            }
+
+            // Records are from UTC midnight of the day
+            int32_t base = (int32_t)((int64_t)(firstDay + d) * 86400 - dayStart);
+            for (int j = 0; j < SITE_TIME_COUNT; j++) {
+                m_time[d][j][i] = (SITE_TIME_NONE == prec->time[j])
+                                    ? SITE_TIME_NONE
+                                    : (prec->time[j] + base);
+            }
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// calculate
+//
+
+void
+CSiteTable::calculate(time_t dayStart, int engine)
+{
+    m_dayBase = dayStart;
+
+    size_t cnt = m_latitude.size();
+    if (!cnt) {
+        return;
+    }
+
+    // Input and output for the batch calculation
+    std::vector<int32_t> firstDay(cnt);
+    std::vector<double> dayNumber(cnt);
+    std::vector<double> tzone(cnt);
+    std::vector<double> t[SITE_TIME_COUNT];
+    std::vector<double> daylength(cnt), declination(cnt), maxAltitude(cnt);
+
+    for (int j = 0; j < SITE_TIME_COUNT; j++) {
+        t[j].resize(cnt);
+    }
+
+    for (size_t i = 0; i < cnt; i++) {
+        firstDay[i] = getFirstDay(i);
+    }
+
+    solarBatchResult res;
+    res.psunrise = &t[SITE_TIME_SUNRISE][0];
+    res.psunset = &t[SITE_TIME_SUNSET][0];
+    res.ptwilightSunrise = &t[SITE_TIME_SUNRISE_TWILIGHT][0];
+    res.ptwilightSunset = &t[SITE_TIME_SUNSET_TWILIGHT][0];
+    res.pnoon = &t[SITE_TIME_NOON][0];
+    res.pdaylength = &daylength[0];
+    res.pdeclination = &declination[0];
+    res.pmaxAltitude = &maxAltitude[0];
+
+    for (int d = 0; d < SITE_DAYS; d++) {
+
+        // Local date and offset at local noon for each site
+        bool bSameDay = true;
+        int year = 0, month = 0, day = 0;
+        for (size_t i = 0; i < cnt; i++) {
+            CTimeZone::civilFromDays(firstDay[i] + d, &year, &month, &day);
+            dayNumber[i] = solar_dayNumber(year, month, day, 0);
+            tzone[i] = m_tz[i]->getNoonOffset(year, month, day) / 3600.0;
+            bSameDay = bSameDay && (firstDay[i] == firstDay[0]);
+        }
+
+        // The AVX2 batch code is the fastest. Without it the compile
+        // time table is faster than the scalar code if it covers the
+        // day, which all sites must share.
+        const solarDayTerms* pterms =
+          bSameDay ? solar_getDayTerms(year, month, day) : NULL;
+        if (SOLAR_ENGINE_NOAA == engine) {
+            solar_calculateNoaaBatch(
+              cnt, &dayNumber[0], &m_latitude[0], &m_longitude[0], &tzone[0], &res);
+        } else if (!solar_batchIsVectorized() && (NULL != pterms)) {
+            solar_calculateSitesFromTerms(
+              pterms, cnt, &m_latitude[0], &m_longitude[0], &tzone[0], &res);
+        } else {
+            solar_calculateBatch(
+              cnt, &dayNumber[0], &m_latitude[0], &m_longitude[0], &tzone[0], &res);
+        }
+
+        // Local decimal hours to seconds from the start of the day
+        // of the instance
+        for (int j = 0; j < SITE_TIME_COUNT; j++) {
+            for (size_t i = 0; i < cnt; i++) {
+                int32_t secs = toUtcSeconds(t[j][i], tzone[i]);
+                m_time[d][j][i] =
+                  (SITE_TIME_NONE == secs)
+                    ? SITE_TIME_NONE
+                    : (int32_t)(secs + (int64_t)(firstDay[i] + d) * 86400 - dayStart);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// toUtcSeconds
+//
+
+int32_t
+CSiteTable::toUtcSeconds(double localHours, double tzone)
+{
+    int secs = solar_toSecondOfDay(localHours);
+    if (SOLAR_NO_TIME == secs) {
+        return SITE_TIME_NONE;
+    }
+
+    return (int32_t)(secs - lround(tzone * 3600));
+}
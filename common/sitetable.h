@@ -0,0 +1,184 @@
+// sitetable.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SITETABLE__INCLUDED_)
+#define VSCPAUTOMATION_SITETABLE__INCLUDED_
+
+#include <vector>
+
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+class CScheduleFile;
+class CTimeZone;
+
+// Calculated times for a site. Also bit numbers in the enable mask.
+#define SITE_TIME_SUNRISE_TWILIGHT 0
+#define SITE_TIME_SUNRISE          1
+#define SITE_TIME_NOON             2
+#define SITE_TIME_SUNSET           3
+#define SITE_TIME_SUNSET_TWILIGHT  4
+#define SITE_TIME_COUNT            5
+
+// All times enabled
+#define SITE_ENABLE_ALL ((1 << SITE_TIME_COUNT) - 1)
+
+// Stored for a time the site does not have this day (polar day/night)
+#define SITE_TIME_NONE INT32_MIN
+
+// Number of local days calculated for each site. A site in another time
+// zone than the instance has parts of two local days within one day of
+// the instance.
+#define SITE_DAYS 2
+
+///////////////////////////////////////////////////////////////////////////////
+// Table of sites
+//
+// Locations handled by one driver instance. The data is stored as one
+// array per field so the daily calculation runs as one loop over tightly
+// packed data. Calculated times are stored as seconds from the start of
+// the day of the instance, rounded to the nearest second.
+//
+// Each site has its own time zone. The local day of the site when the
+// day of the instance starts and the day after are calculated.
+//
+
+class CSiteTable
+{
+
+  public:
+    /// Constructor
+    CSiteTable(void);
+
+    /*!
+        Add a site
+        @param latitude Latitude in degrees
+        @param longitude Longitude in degrees
+        @param ptz Time zone of the site
+        @param zone Zone for events from the site
+        @param subzone Subzone for events from the site
+        @param enable Mask with enabled times, bit SITE_TIME_xxx
+        @return Index for the site
+    */
+    size_t addSite(double latitude,
+                   double longitude,
+                   const CTimeZone *ptz,
+                   uint8_t zone,
+                   uint8_t subzone,
+                   uint8_t enable);
+
+    /// Remove all sites
+    void clear(void);
+
+    /// Number of sites
+    size_t size(void) const { return m_latitude.size(); };
+
+    /*!
+        Calculate the times for all sites
+        @param dayStart Start of the day of the instance, seconds
+                since epoch
+        @param engine SOLAR_ENGINE_LEGACY or SOLAR_ENGINE_NOAA
+    */
+    void calculate(time_t dayStart, int engine);
+
+    /*!
+        Take the times from a schedule file instead of calculating them
+        @param schedule Mapped schedule file
+        @param firstSite Index in the file for the first site in the table
+        @param dayStart Start of the day of the instance, seconds
+                since epoch
+        @return true if the file had the days for all sites
+    */
+    bool loadSchedule(const CScheduleFile &schedule,
+                      size_t firstSite,
+                      time_t dayStart);
+
+    /*!
+        Get a calculated time
+        @param idx Site index
+        @param what SITE_TIME_xxx
+        @param day Local day of the site, 0 to SITE_DAYS - 1
+        @return Absolute time in seconds since epoch, zero if the site
+                does not have the time this day
+    */
+    time_t getTime(size_t idx, int what, int day = 0) const
+    {
+        if (SITE_TIME_NONE == m_time[day][what][idx]) {
+            return 0;
+        }
+        return m_dayBase + m_time[day][what][idx];
+    };
+
+    /// True if the time is enabled for the site
+    bool isEnabled(size_t idx, int what) const
+    {
+        return (0 != (m_enable[idx] & (1 << what)));
+    };
+
+    uint8_t getZone(size_t idx) const { return m_zone[idx]; };
+    uint8_t getSubzone(size_t idx) const { return m_subzone[idx]; };
+    double getLatitude(size_t idx) const { return m_latitude[idx]; };
+    double getLongitude(size_t idx) const { return m_longitude[idx]; };
+
+    /// Time zone of a site
+    const CTimeZone *getTimeZone(size_t idx) const { return m_tz[idx]; };
+
+    /*!
+        Convert a calculated local time to seconds from UTC midnight
+        @param localHours Local decimal hours, NaN if there is no time
+        @param tzone Offset from UTC in hours
+        @return Seconds from UTC midnight or SITE_TIME_NONE
+    */
+    static int32_t toUtcSeconds(double localHours, double tzone);
+
+  private:
+    /*!
+        Local day of a site when the day of the instance starts
+        @param idx Site index
+        @return Days since 1970-01-01
+    */
+    int32_t getFirstDay(size_t idx) const;
+
+  private:
+    // Per site configuration
+    std::vector<double> m_latitude;
+    std::vector<double> m_longitude;
+    std::vector<const CTimeZone *> m_tz;
+    std::vector<uint8_t> m_zone;
+    std::vector<uint8_t> m_subzone;
+    std::vector<uint8_t> m_enable;
+
+    /// Start of the day of the instance
+    time_t m_dayBase;
+
+    /// Calculated times for each local day, seconds from m_dayBase
+    std::vector<int32_t> m_time[SITE_DAYS][SITE_TIME_COUNT];
+};
+
+#endif
@@ -0,0 +1,406 @@
+// solarbatch.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <math.h>
+
+#include "solarcalc.h"
+#include "solarbatch.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SOLAR_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// calculateScalar
+//
+
+static void
+calculateScalar(size_t start,
+                size_t cnt,
+                const double *pday,
+                const double *plat,
+                const double *plon,
+                const double *ptz,
+                const solarBatchResult *pres)
+{
+    for (size_t i = start; i < cnt; i++) {
+        solarResult r;
+        solar_calculateDay(pday[i], plat[i], plon[i], ptz[i], &r);
+        pres->psunrise[i] = r.sunrise;
+        pres->psunset[i] = r.sunset;
+        pres->ptwilightSunrise[i] = r.twilightSunrise;
+        pres->ptwilightSunset[i] = r.twilightSunset;
+        pres->pnoon[i] = r.noon;
+        pres->pdaylength[i] = r.daylength;
+        pres->pdeclination[i] = r.declination;
+        pres->pmaxAltitude[i] = r.maxAltitude;
+    }
+}
+
+#if defined(SOLAR_HAVE_AVX2)
+
+#define SOLAR_AVX2 __attribute__((target("avx2,fma"), always_inline)) inline
+
+// Cody-Waite split of pi/2
+#define PIO2_1 1.57079625129699707031E0
+#define PIO2_2 7.54978941586159635336E-8
+#define PIO2_3 5.39030285815811905290E-15
+
+// Cephes atan constants
+#define T3P8     2.41421356237309504880E0 // tan(3*pi/8)
+#define MOREBITS 6.12323399573676588613E-17
+
+static SOLAR_AVX2 __m256d
+v_set(double x)
+{
+    return _mm256_set1_pd(x);
+}
+
+// Select a where mask is set, otherwise b
+static SOLAR_AVX2 __m256d
+v_sel(__m256d mask, __m256d a, __m256d b)
+{
+    return _mm256_blendv_pd(b, a, mask);
+}
+
+static SOLAR_AVX2 __m256d
+v_lt(__m256d a, __m256d b)
+{
+    return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+}
+
+static SOLAR_AVX2 __m256d
+v_gt(__m256d a, __m256d b)
+{
+    return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+}
+
+static SOLAR_AVX2 __m256d
+v_neg(__m256d a)
+{
+    return _mm256_xor_pd(a, v_set(-0.0));
+}
+
+// sin and cos of x
+static SOLAR_AVX2 void
+v_sincos(__m256d x, __m256d *ps, __m256d *pc)
+{
+    // Reduce to |r| <= pi/4 and quadrant q
+    __m256d q = _mm256_round_pd(_mm256_mul_pd(x, v_set(2.0 / M_PI)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(q, v_set(PIO2_1), x);
+    r = _mm256_fnmadd_pd(q, v_set(PIO2_2), r);
+    r = _mm256_fnmadd_pd(q, v_set(PIO2_3), r);
+    __m256d z = _mm256_mul_pd(r, r);
+
+    // Cephes minimax polynomials for |r| <= pi/4
+    __m256d ps_ = v_set(1.58962301576546568060E-10);
+    ps_ = _mm256_fmadd_pd(ps_, z, v_set(-2.50507477628578072866E-8));
+    ps_ = _mm256_fmadd_pd(ps_, z, v_set(2.75573136213857245213E-6));
+    ps_ = _mm256_fmadd_pd(ps_, z, v_set(-1.98412698295895385996E-4));
+    ps_ = _mm256_fmadd_pd(ps_, z, v_set(8.33333333332211858878E-3));
+    ps_ = _mm256_fmadd_pd(ps_, z, v_set(-1.66666666666666307295E-1));
+    __m256d sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps_, r);
+
+    __m256d pc_ = v_set(-1.13585365213876817300E-11);
+    pc_ = _mm256_fmadd_pd(pc_, z, v_set(2.08757008419747316778E-9));
+    pc_ = _mm256_fmadd_pd(pc_, z, v_set(-2.75573141792967388112E-7));
+    pc_ = _mm256_fmadd_pd(pc_, z, v_set(2.48015872888517045348E-5));
+    pc_ = _mm256_fmadd_pd(pc_, z, v_set(-1.38888888888730564116E-3));
+    pc_ = _mm256_fmadd_pd(pc_, z, v_set(4.16666666666665929218E-2));
+    __m256d cr = _mm256_fmadd_pd(_mm256_mul_pd(z, z),
+                                 pc_,
+                                 _mm256_fnmadd_pd(v_set(0.5), z, v_set(1.0)));
+
+    // Quadrant 0-3
+    __m256d q4 = _mm256_sub_pd(
+      q,
+      _mm256_mul_pd(v_set(4.0),
+                    _mm256_floor_pd(_mm256_mul_pd(q, v_set(0.25)))));
+    __m256d odd = _mm256_cmp_pd(
+      _mm256_sub_pd(
+        q4, _mm256_mul_pd(v_set(2.0), _mm256_floor_pd(_mm256_mul_pd(q4, v_set(0.5))))),
+      v_set(1.0),
+      _CMP_EQ_OQ);
+
+    __m256d s = v_sel(odd, cr, sr);
+    __m256d c = v_sel(odd, sr, cr);
+
+    // sin is negative in quadrant 2 and 3, cos in quadrant 1 and 2
+    __m256d negs = _mm256_cmp_pd(q4, v_set(2.0), _CMP_GE_OQ);
+    __m256d negc = _mm256_and_pd(_mm256_cmp_pd(q4, v_set(1.0), _CMP_GE_OQ),
+                                 _mm256_cmp_pd(q4, v_set(2.0), _CMP_LE_OQ));
+
+    *ps = v_sel(negs, v_neg(s), s);
+    *pc = v_sel(negc, v_neg(c), c);
+}
+
+// atan of x
+static SOLAR_AVX2 __m256d
+v_atan(__m256d x)
+{
+    __m256d sign = _mm256_and_pd(x, v_set(-0.0));
+    __m256d ax = _mm256_andnot_pd(v_set(-0.0), x);
+
+    // Range reduction
+    __m256d big = v_gt(ax, v_set(T3P8));
+    __m256d mid = _mm256_andnot_pd(big, v_gt(ax, v_set(0.66)));
+
+    __m256d xr = v_sel(
+      big,
+      v_neg(_mm256_div_pd(v_set(1.0), ax)),
+      v_sel(mid,
+            _mm256_div_pd(_mm256_sub_pd(ax, v_set(1.0)),
+                          _mm256_add_pd(ax, v_set(1.0))),
+            ax));
+    __m256d y0 =
+      v_sel(big, v_set(M_PI / 2), v_sel(mid, v_set(M_PI / 4), v_set(0.0)));
+    __m256d extra =
+      v_sel(big, v_set(MOREBITS), v_sel(mid, v_set(0.5 * MOREBITS), v_set(0.0)));
+
+    __m256d z = _mm256_mul_pd(xr, xr);
+
+    __m256d p = v_set(-8.750608600031904122785E-1);
+    p = _mm256_fmadd_pd(p, z, v_set(-1.615753718733365076637E1));
+    p = _mm256_fmadd_pd(p, z, v_set(-7.500855792314704667340E1));
+    p = _mm256_fmadd_pd(p, z, v_set(-1.228866684490136173410E2));
+    p = _mm256_fmadd_pd(p, z, v_set(-6.485021904942025371773E1));
+
+    __m256d q = _mm256_add_pd(z, v_set(2.485846490142306297962E1));
+    q = _mm256_fmadd_pd(q, z, v_set(1.650270098316988542046E2));
+    q = _mm256_fmadd_pd(q, z, v_set(4.328810604912902668951E2));
+    q = _mm256_fmadd_pd(q, z, v_set(4.853903996359136964868E2));
+    q = _mm256_fmadd_pd(q, z, v_set(1.945506571482613964425E2));
+
+    __m256d r = _mm256_mul_pd(_mm256_mul_pd(xr, z), _mm256_div_pd(p, q));
+    r = _mm256_add_pd(_mm256_add_pd(r, xr), extra);
+    r = _mm256_add_pd(y0, r);
+
+    return _mm256_xor_pd(r, sign);
+}
+
+// atan2 of y, x
+static SOLAR_AVX2 __m256d
+v_atan2(__m256d y, __m256d x)
+{
+    __m256d a = v_atan(_mm256_div_pd(y, x));
+    __m256d adj = v_sel(_mm256_cmp_pd(y, v_set(0.0), _CMP_GE_OQ),
+                        v_set(M_PI),
+                        v_set(-M_PI));
+    return v_sel(v_lt(x, v_set(0.0)), _mm256_add_pd(a, adj), a);
+}
+
+// asin of x, NaN outside -1..1 as asin()
+static SOLAR_AVX2 __m256d
+v_asin(__m256d x)
+{
+    __m256d c = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(v_set(1.0), x),
+                                             _mm256_add_pd(v_set(1.0), x)));
+    __m256d a = v_atan2(x, c);
+    __m256d out = v_gt(_mm256_andnot_pd(v_set(-0.0), x), v_set(1.0));
+    return v_sel(out, v_set(NAN), a);
+}
+
+// Angle in the range 0 to 2*pi (with the pi of the scalar code)
+static SOLAR_AVX2 __m256d
+v_range(__m256d x)
+{
+    __m256d b = _mm256_mul_pd(x, v_set(0.5 / SOLAR_PI));
+    __m256d a = _mm256_mul_pd(
+      v_set(2.0 * SOLAR_PI),
+      _mm256_sub_pd(b, _mm256_round_pd(b, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)));
+    return v_sel(v_lt(a, v_set(0.0)), _mm256_add_pd(a, v_set(2.0 * SOLAR_PI)), a);
+}
+
+// Hour angle, see hourAngle in solarcalc.cpp
+static SOLAR_AVX2 __m256d
+v_hourAngle(__m256d lat, __m256d tanLat, __m256d delta, double dh)
+{
+    __m256d vdh = v_sel(v_lt(lat, v_set(0.0)), v_set(-dh), v_set(dh));
+    __m256d s, c;
+    v_sincos(_mm256_add_pd(delta, vdh), &s, &c);
+    __m256d fo = _mm256_mul_pd(_mm256_div_pd(s, c), tanLat);
+    fo = v_sel(v_gt(fo, v_set(0.99999)), v_set(1.0), fo);
+    return _mm256_add_pd(v_asin(fo), v_set(SOLAR_PI / 2.0));
+}
+
+// Subtract 24 from values above 24
+static SOLAR_AVX2 __m256d
+v_wrap24(__m256d x)
+{
+    return v_sel(v_gt(x, v_set(24.0)), _mm256_sub_pd(x, v_set(24.0)), x);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// calculateAvx2
+//
+// Same calculation as solar_calculateDay, four tuples at a time
+//
+
+__attribute__((target("avx2,fma"))) static size_t
+calculateAvx2(size_t cnt,
+              const double *pday,
+              const double *plat,
+              const double *plon,
+              const double *ptz,
+              const solarBatchResult *pres)
+{
+    const double rads = SOLAR_RADS;
+    size_t i;
+
+    for (i = 0; (i + 4) <= cnt; i += 4) {
+
+        __m256d d = _mm256_loadu_pd(pday + i);
+        __m256d lat = _mm256_loadu_pd(plat + i);
+        __m256d lon = _mm256_loadu_pd(plon + i);
+        __m256d tz = _mm256_loadu_pd(ptz + i);
+
+        // Mean longitude and mean anomaly of the Sun
+        __m256d L = v_range(
+          _mm256_fmadd_pd(v_set(.9856474 * rads), d, v_set(280.461 * rads)));
+        __m256d g = v_range(
+          _mm256_fmadd_pd(v_set(.9856003 * rads), d, v_set(357.528 * rads)));
+
+        // Ecliptic longitude of the Sun
+        __m256d sg, cg;
+        v_sincos(g, &sg, &cg);
+        __m256d s2g = _mm256_mul_pd(v_set(2.0), _mm256_mul_pd(sg, cg));
+        __m256d lambda = v_range(_mm256_fmadd_pd(
+          v_set(.02 * rads), s2g, _mm256_fmadd_pd(v_set(1.915 * rads), sg, L)));
+
+        // Obliquity of the ecliptic
+        __m256d obliq =
+          _mm256_fnmadd_pd(v_set(0.0000004 * rads), d, v_set(23.439 * rads));
+
+        // RA and DEC of the Sun
+        __m256d sl, cl, so, co;
+        v_sincos(lambda, &sl, &cl);
+        v_sincos(obliq, &so, &co);
+        __m256d alpha = v_atan2(_mm256_mul_pd(co, sl), cl);
+        __m256d delta = v_asin(_mm256_mul_pd(so, sl));
+
+        // Equation of Time in minutes
+        __m256d LL = _mm256_sub_pd(L, alpha);
+        LL = v_sel(v_lt(L, v_set(SOLAR_PI)), _mm256_add_pd(LL, v_set(2.0 * SOLAR_PI)), LL);
+        __m256d equation = _mm256_mul_pd(
+          v_set(1440.0),
+          _mm256_fnmadd_pd(LL, v_set(1.0 / SOLAR_PI / 2.0), v_set(1.0)));
+
+        __m256d slat, clat;
+        v_sincos(_mm256_mul_pd(lat, v_set(rads)), &slat, &clat);
+        __m256d tanLat = _mm256_div_pd(slat, clat);
+
+        __m256d ha = v_hourAngle(
+          lat, tanLat, delta, rads * (0.5 * SOLAR_SUN_DIA + SOLAR_AIR_REFR));
+        __m256d hb = v_hourAngle(lat, tanLat, delta, rads * 6.0);
+        __m256d twx =
+          _mm256_mul_pd(v_set(12.0 / SOLAR_PI), _mm256_sub_pd(hb, ha));
+
+        __m256d daylen = _mm256_mul_pd(v_set(SOLAR_DEGS / 7.5), ha);
+        daylen = v_sel(v_lt(daylen, v_set(0.0001)), v_set(0.0), daylen);
+
+        __m256d base = _mm256_add_pd(
+          _mm256_fnmadd_pd(lon, v_set(1.0 / 15.0), tz),
+          _mm256_mul_pd(equation, v_set(1.0 / 60.0)));
+        __m256d half = _mm256_mul_pd(v_set(12.0 / SOLAR_PI), ha);
+        __m256d sunrise = _mm256_add_pd(_mm256_sub_pd(v_set(12.0), half), base);
+        __m256d sunset = _mm256_add_pd(_mm256_add_pd(v_set(12.0), half), base);
+        __m256d noon = _mm256_add_pd(sunrise, half);
+
+        __m256d declination = _mm256_mul_pd(delta, v_set(SOLAR_DEGS));
+        __m256d maxAltitude =
+          _mm256_sub_pd(_mm256_add_pd(v_set(90.0), declination), lat);
+        maxAltitude = v_sel(v_lt(lat, declination),
+                            _mm256_sub_pd(v_set(180.0), maxAltitude),
+                            maxAltitude);
+
+        __m256d twilightSunrise = _mm256_sub_pd(sunrise, twx);
+        __m256d twilightSunset = _mm256_add_pd(sunset, twx);
+
+        _mm256_storeu_pd(pres->psunrise + i, v_wrap24(sunrise));
+        _mm256_storeu_pd(pres->psunset + i, v_wrap24(sunset));
+        _mm256_storeu_pd(pres->ptwilightSunrise + i, v_wrap24(twilightSunrise));
+        _mm256_storeu_pd(pres->ptwilightSunset + i, v_wrap24(twilightSunset));
+        _mm256_storeu_pd(pres->pnoon + i, noon);
+        _mm256_storeu_pd(pres->pdaylength + i, daylen);
+        _mm256_storeu_pd(pres->pdeclination + i, declination);
+        _mm256_storeu_pd(pres->pmaxAltitude + i, maxAltitude);
+    }
+
+    return i;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_batchIsVectorized
+//
+
+bool
+solar_batchIsVectorized(void)
+{
+#if defined(SOLAR_HAVE_AVX2)
+    static const bool bAvx2 =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return bAvx2;
+#else
+    return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateBatch
+//
+
+void
+solar_calculateBatch(size_t cnt,
+                     const double *pdayNumber,
+                     const double *platitude,
+                     const double *plongitude,
+                     const double *ptzone,
+                     const solarBatchResult *presult)
+{
+    size_t done = 0;
+
+    if ((0 == pdayNumber) || (0 == platitude) || (0 == plongitude) ||
+        (0 == ptzone) || (0 == presult)) {
+        return;
+    }
+
+#if defined(SOLAR_HAVE_AVX2)
+    if (solar_batchIsVectorized()) {
+        done = calculateAvx2(
+          cnt, pdayNumber, platitude, plongitude, ptzone, presult);
+    }
+#endif
+
+    // Remaining tuples (or all if not vectorized)
+    calculateScalar(
+      done, cnt, pdayNumber, platitude, plongitude, ptzone, presult);
+}
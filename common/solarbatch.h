@@ -0,0 +1,84 @@
+// solarbatch.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SOLARBATCH__INCLUDED_)
+#define VSCPAUTOMATION_SOLARBATCH__INCLUDED_
+
+#include <stddef.h>
+
+// Batch version of solar_calculateDay
+//
+// Many (day, latitude, longitude) tuples are calculated in one call. On
+// CPU's with AVX2 and FMA four tuples are calculated at a time with
+// vectorized polynomial versions of the trigonometric functions. Other
+// CPU's use the scalar code. The choice is made at runtime.
+//
+// The vectorized functions are accurate to a few ulp which is far below
+// the minute resolution of the result.
+
+/*!
+    Output arrays for a batch. All arrays must hold the number of
+    tuples in the batch. Same meaning as the solarResult members.
+*/
+struct solarBatchResult
+{
+    double *psunrise;
+    double *psunset;
+    double *ptwilightSunrise;
+    double *ptwilightSunset;
+    double *pnoon;
+    double *pdaylength;
+    double *pdeclination;
+    double *pmaxAltitude;
+};
+
+/*!
+    Calculate sunrise/sunset times for a batch of tuples
+    @param cnt Number of tuples
+    @param pdayNumber Days to J2000 from solar_dayNumber
+    @param platitude Latitudes in degrees
+    @param plongitude Longitudes in degrees
+    @param ptzone Offsets from UTC in hours
+    @param presult Output arrays
+*/
+void
+solar_calculateBatch(size_t cnt,
+                     const double *pdayNumber,
+                     const double *platitude,
+                     const double *plongitude,
+                     const double *ptzone,
+                     const solarBatchResult *presult);
+
+/*!
+    Check which code solar_calculateBatch use
+    @return true if the vectorized code is used
+*/
+bool
+solar_batchIsVectorized(void);
+
+#endif
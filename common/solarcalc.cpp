@@ -0,0 +1,209 @@
+// solarcalc.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <math.h>
+
+#include "solarcalc.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// range
+//
+// Return an angle in the range 0 to 2*pi
+//
+
+static double
+range(double x)
+{
+    double b = 0.5 * x / SOLAR_PI;
+    double a = 2.0 * SOLAR_PI * (b - (long)(b));
+    if (a < 0)
+        a = 2.0 * SOLAR_PI + a;
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hourAngle
+//
+// Calculating the hourangle for the sun at the altitude given by
+// the correction (in radians) dh
+//
+
+static double
+hourAngle(double lat, double declin, double dh)
+{
+    double fo;
+    // Correction: different sign at S HS
+    if (lat < 0.0)
+        dh = -dh;
+    fo = tan(declin + dh) * tan(lat * SOLAR_RADS);
+    if (fo > 0.99999)
+        fo = 1.0; // to avoid overflow //
+    return asin(fo) + SOLAR_PI / 2.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_dayNumber
+//
+
+double
+solar_dayNumber(int y, int m, int d, double h)
+{
+    long int luku = -7 * (y + (m + 9) / 12) / 4 + 275 * m / 9 + d;
+    // type casting necessary on PC DOS and TClite to avoid overflow
+    luku += (long int)y * 367;
+    return (double)luku - 730531.5 + h / 24.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculate
+//
+
+void
+solar_calculate(int year,
+                int month,
+                int day,
+                double hour,
+                double latitude,
+                double longitude,
+                double tzone,
+                solarResult *presult)
+{
+    solar_calculateDay(solar_dayNumber(year, month, day, hour),
+                       latitude,
+                       longitude,
+                       tzone,
+                       presult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateDay
+//
+
+void
+solar_calculateDay(double d,
+                   double latitude,
+                   double longitude,
+                   double tzone,
+                   solarResult *presult)
+{
+    double L, g, lambda;
+    double obliq, alpha, delta, LL, equation, ha, hb, twx;
+
+    if (0 == presult) {
+        return;
+    }
+
+    // Mean longitude of the Sun
+    L = range(280.461 * SOLAR_RADS + .9856474 * SOLAR_RADS * d);
+
+    // Mean anomaly of the Sun
+    g = range(357.528 * SOLAR_RADS + .9856003 * SOLAR_RADS * d);
+
+    // Ecliptic longitude of the Sun
+    lambda = range(L + 1.915 * SOLAR_RADS * sin(g) + .02 * SOLAR_RADS * sin(2 * g));
+
+    // Obliquity of the ecliptic
+    obliq = 23.439 * SOLAR_RADS - 0.0000004 * SOLAR_RADS * d;
+
+    // Find the RA and DEC of the Sun
+    alpha = atan2(cos(obliq) * sin(lambda), cos(lambda));
+    delta = asin(sin(obliq) * sin(lambda));
+
+    // Find the Equation of Time in minutes
+    // Correction suggested by David Smith
+    LL = L - alpha;
+    if (L < SOLAR_PI)
+        LL += 2.0 * SOLAR_PI;
+    equation = 1440.0 * (1.0 - LL / SOLAR_PI / 2.0);
+    ha = hourAngle(latitude, delta, SOLAR_RADS * (0.5 * SOLAR_SUN_DIA + SOLAR_AIR_REFR));
+    hb = hourAngle(latitude, delta, SOLAR_RADS * 6.0);
+    twx = hb - ha;               // length of twilight in radians
+    twx = 12.0 * twx / SOLAR_PI; // length of twilight in hours
+
+    // Conversion of angle to hours and minutes
+    presult->daylength = SOLAR_DEGS * ha / 7.5;
+    if (presult->daylength < 0.0001) {
+        presult->daylength = 0.0;
+    }
+
+    // arctic winter
+    presult->sunrise = 12.0 - 12.0 * ha / SOLAR_PI + tzone - longitude / 15.0 +
+                       equation / 60.0;
+    presult->sunset = 12.0 + 12.0 * ha / SOLAR_PI + tzone - longitude / 15.0 +
+                      equation / 60.0;
+    presult->noon = presult->sunrise + 12.0 * ha / SOLAR_PI;
+    presult->maxAltitude = 90.0 + delta * SOLAR_DEGS - latitude;
+    // Correction for S HS suggested by David Smith
+    // to express altitude as degrees from the N horizon
+    if (latitude < delta * SOLAR_DEGS)
+        presult->maxAltitude = 180.0 - presult->maxAltitude;
+
+    presult->twilightSunrise = presult->sunrise - twx; // morning twilight begin
+    presult->twilightSunset = presult->sunset + twx;   // evening twilight end
+
+    if (presult->sunrise > 24.0)
+        presult->sunrise -= 24.0;
+    if (presult->sunset > 24.0)
+        presult->sunset -= 24.0;
+    if (presult->twilightSunrise > 24.0)
+        presult->twilightSunrise -= 24.0; // 160921
+    if (presult->twilightSunset > 24.0)
+        presult->twilightSunset -= 24.0;
+
+    presult->declination = delta * SOLAR_DEGS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_toHourMinute
+//
+
+void
+solar_toHourMinute(double floatTime, int *pHours, int *pMinutes)
+{
+    *pHours = ((int)floatTime) % 24;
+    *pMinutes = ((int)((floatTime - (double)*pHours) * 60)) % 60;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_toSecondOfDay
+//
+
+int
+solar_toSecondOfDay(double floatTime)
+{
+    if (isnan(floatTime)) {
+        return SOLAR_NO_TIME;
+    }
+
+    long secs = lround(floatTime * 3600.0) % 86400;
+    if (secs < 0) {
+        secs += 86400;
+    }
+
+    return (int)secs;
+}
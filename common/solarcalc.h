@@ -0,0 +1,144 @@
+// solarcalc.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SOLARCALC__INCLUDED_)
+#define VSCPAUTOMATION_SOLARCALC__INCLUDED_
+
+// Sunrise/sunset calculation
+//
+// Based on the C program by Jarmo Lammi 1999 - 2001 calculating the
+// sunrise and sunset for a date and a fixed location (latitude,
+// longitude). Twilight calculation gives insufficient accuracy of results.
+//
+// All functions are pure. They only depend on their arguments and can be
+// called from any number of threads at the same time.
+
+// Value of pi used by the original program. Kept so the results are
+// the same as before.
+#define SOLAR_PI 3.14159
+
+#define SOLAR_DEGS (180.0 / SOLAR_PI)
+#define SOLAR_RADS (SOLAR_PI / 180.0)
+
+// Sun radius degrees
+#define SOLAR_SUN_DIA 0.53
+
+// Atmospheric refraction degrees
+#define SOLAR_AIR_REFR (34.0 / 60.0)
+
+// Calculation engines
+#define SOLAR_ENGINE_LEGACY 0 // This code
+#define SOLAR_ENGINE_NOAA   1 // NOAA/Meeus, see solarnoaa.h
+
+/*!
+    Result of a calculation. Times are local decimal hours in
+    the range 0-24.
+*/
+struct solarResult
+{
+    double sunrise;
+    double sunset;
+    double twilightSunrise; // Civil twilight start (morning)
+    double twilightSunset;  // Civil twilight end (evening)
+    double noon;
+    double daylength;   // Length of day in hours
+    double declination; // Declination of the sun in degrees
+    double maxAltitude; // Max altitude of the sun in degrees
+};
+
+/*!
+    Get the days to J2000. Only works between 1901 to 2099 - see
+    Meeus chapter 7
+    @param y Year
+    @param m Month 1-12
+    @param d Day 1-31
+    @param h UT in decimal hours
+    @return Days to J2000
+*/
+double
+solar_dayNumber(int y, int m, int d, double h);
+
+/*!
+    Calculate sunrise/sunset times for a day and a location
+    @param year Year
+    @param month Month 1-12
+    @param day Day 1-31
+    @param hour Hour of day used for the calculation
+    @param latitude Latitude in degrees
+    @param longitude Longitude in degrees
+    @param tzone Offset from UTC in hours
+    @param presult Pointer to structure that will get the result
+*/
+void
+solar_calculate(int year,
+                int month,
+                int day,
+                double hour,
+                double latitude,
+                double longitude,
+                double tzone,
+                solarResult *presult);
+
+/*!
+    Calculate sunrise/sunset times for a day number and a location
+    @param dayNumber Days to J2000 from solar_dayNumber
+    @param latitude Latitude in degrees
+    @param longitude Longitude in degrees
+    @param tzone Offset from UTC in hours
+    @param presult Pointer to structure that will get the result
+*/
+void
+solar_calculateDay(double dayNumber,
+                   double latitude,
+                   double longitude,
+                   double tzone,
+                   solarResult *presult);
+
+/*!
+    Convert decimal hours to hours and minutes
+    @param floatTime Decimal hours
+    @param pHours Pointer to int that get hours 0-23
+    @param pMinutes Pointer to int that get minutes 0-59
+*/
+void
+solar_toHourMinute(double floatTime, int *pHours, int *pMinutes);
+
+// Returned by solar_toSecondOfDay if there is no time
+#define SOLAR_NO_TIME -1
+
+/*!
+    Convert decimal hours to seconds from midnight, rounded to the
+    nearest second
+    @param floatTime Decimal hours
+    @return Seconds 0-86399 or SOLAR_NO_TIME if floatTime is NaN (the
+            sun does not rise/set this day)
+*/
+int
+solar_toSecondOfDay(double floatTime);
+
+#endif
@@ -0,0 +1,259 @@
+// solarnoaa.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <math.h>
+
+#include "solarnoaa.h"
+
+#define NOAA_PI   3.14159265358979323846
+#define NOAA_RADS (NOAA_PI / 180.0)
+#define NOAA_DEGS (180.0 / NOAA_PI)
+
+// Sun altitude at sunrise/sunset and civil twilight in degrees
+#define NOAA_SUNRISE_ALTITUDE  -0.833
+#define NOAA_TWILIGHT_ALTITUDE -6.0
+
+// Number of times an event time is calculated again
+#define NOAA_ITERATIONS 3
+
+///////////////////////////////////////////////////////////////////////////////
+// sunPosition
+//
+// Declination (radians) and equation of time (minutes) at a julian day
+//
+
+static void
+sunPosition(double jd, double *pdeclination, double *pequation)
+{
+    // Julian centuries from J2000
+    double T = (jd - 2451545.0) / 36525.0;
+
+    double L0 = fmod(280.46646 + T * (36000.76983 + T * 0.0003032), 360.0);
+    double M = 357.52911 + T * (35999.05029 - 0.0001537 * T);
+    double e = 0.016708634 - T * (0.000042037 + 0.0000001267 * T);
+
+    double Mr = M * NOAA_RADS;
+    double C = sin(Mr) * (1.914602 - T * (0.004817 + 0.000014 * T)) +
+               sin(2 * Mr) * (0.019993 - 0.000101 * T) +
+               sin(3 * Mr) * 0.000289;
+
+    // Apparent longitude, corrected for nutation and aberration
+    double omega = (125.04 - 1934.136 * T) * NOAA_RADS;
+    double lambda = (L0 + C - 0.00569 - 0.00478 * sin(omega)) * NOAA_RADS;
+
+    // Obliquity of the ecliptic
+    double eps0 =
+      23.0 +
+      (26.0 + (21.448 - T * (46.815 + T * (0.00059 - T * 0.001813))) / 60.0) /
+        60.0;
+    double eps = (eps0 + 0.00256 * cos(omega)) * NOAA_RADS;
+
+    *pdeclination = asin(sin(eps) * sin(lambda));
+
+    double y = tan(eps / 2);
+    y *= y;
+    double L0r = L0 * NOAA_RADS;
+    double eq = y * sin(2 * L0r) - 2 * e * sin(Mr) +
+                4 * e * y * sin(Mr) * cos(2 * L0r) -
+                0.5 * y * y * sin(4 * L0r) - 1.25 * e * e * sin(2 * Mr);
+
+    *pequation = 4.0 * eq * NOAA_DEGS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hourAngle
+//
+// Hour angle in degrees when the sun is at an altitude. 180 if the sun is
+// always above it and NaN if it never gets there.
+//
+
+static double
+hourAngle(double latitude, double declination, double altitude)
+{
+    double lat = latitude * NOAA_RADS;
+    double cosH = (sin(altitude * NOAA_RADS) - sin(lat) * sin(declination)) /
+                  (cos(lat) * cos(declination));
+
+    if (cosH < -1.0) {
+        return 180.0;
+    }
+    if (cosH > 1.0) {
+        return NAN;
+    }
+
+    return acos(cosH) * NOAA_DEGS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// eventTime
+//
+// Time of sunrise (sign -1) or sunset (sign 1) in UT minutes from midnight.
+// Starts at noon and moves the sun to the time of the event.
+//
+
+static double
+eventTime(double jd0,
+          double latitude,
+          double longitude,
+          double altitude,
+          double sign,
+          double noon)
+{
+    double t = noon;
+
+    for (int i = 0; i < NOAA_ITERATIONS; i++) {
+        double declination, equation;
+        sunPosition(jd0 + t / 1440.0, &declination, &equation);
+
+        double H = hourAngle(latitude, declination, altitude);
+        if (isnan(H)) {
+            return NAN;
+        }
+
+        t = 720.0 - 4.0 * (longitude - sign * H) - equation;
+    }
+
+    return t;
+}
+
+// Local decimal hours in the range 0-24 from UT minutes
+static double
+localHours(double t, double tzone)
+{
+    double h = t / 60.0 + tzone;
+    h -= 24.0 * floor(h / 24.0);
+    return h;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateNoaaDay
+//
+
+void
+solar_calculateNoaaDay(double d,
+                       double latitude,
+                       double longitude,
+                       double tzone,
+                       solarResult *presult)
+{
+    double declination, equation;
+
+    if (NULL == presult) {
+        return;
+    }
+
+    // Julian day for UT midnight
+    double jd0 = d + 2451545.0;
+
+    // Solar noon, the sun position at noon gives the noon time
+    double noon = 720.0 - 4.0 * longitude;
+    for (int i = 0; i < NOAA_ITERATIONS; i++) {
+        sunPosition(jd0 + noon / 1440.0, &declination, &equation);
+        noon = 720.0 - 4.0 * longitude - equation;
+    }
+    sunPosition(jd0 + noon / 1440.0, &declination, &equation);
+
+    double rise =
+      eventTime(jd0, latitude, longitude, NOAA_SUNRISE_ALTITUDE, -1.0, noon);
+    double set =
+      eventTime(jd0, latitude, longitude, NOAA_SUNRISE_ALTITUDE, 1.0, noon);
+    double twilightRise =
+      eventTime(jd0, latitude, longitude, NOAA_TWILIGHT_ALTITUDE, -1.0, noon);
+    double twilightSet =
+      eventTime(jd0, latitude, longitude, NOAA_TWILIGHT_ALTITUDE, 1.0, noon);
+
+    presult->noon = localHours(noon, tzone);
+    presult->sunrise = localHours(rise, tzone);
+    presult->sunset = localHours(set, tzone);
+    presult->twilightSunrise = localHours(twilightRise, tzone);
+    presult->twilightSunset = localHours(twilightSet, tzone);
+
+    if (isnan(rise) || isnan(set)) {
+        presult->daylength = 0.0;
+    } else {
+        presult->daylength = (set - rise) / 60.0;
+        if (presult->daylength > 24.0) {
+            presult->daylength = 24.0;
+        }
+    }
+
+    presult->declination = declination * NOAA_DEGS;
+    presult->maxAltitude = 90.0 - fabs(latitude - presult->declination);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateNoaa
+//
+
+void
+solar_calculateNoaa(int year,
+                    int month,
+                    int day,
+                    double latitude,
+                    double longitude,
+                    double tzone,
+                    solarResult *presult)
+{
+    solar_calculateNoaaDay(solar_dayNumber(year, month, day, 0),
+                           latitude,
+                           longitude,
+                           tzone,
+                           presult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateNoaaBatch
+//
+
+void
+solar_calculateNoaaBatch(size_t cnt,
+                         const double *pday,
+                         const double *platitude,
+                         const double *plongitude,
+                         const double *ptzone,
+                         const solarBatchResult *presult)
+{
+    if ((NULL == pday) || (NULL == platitude) || (NULL == plongitude) ||
+        (NULL == ptzone) || (NULL == presult)) {
+        return;
+    }
+
+    for (size_t i = 0; i < cnt; i++) {
+        solarResult r;
+        solar_calculateNoaaDay(
+          pday[i], platitude[i], plongitude[i], ptzone[i], &r);
+        presult->psunrise[i] = r.sunrise;
+        presult->psunset[i] = r.sunset;
+        presult->ptwilightSunrise[i] = r.twilightSunrise;
+        presult->ptwilightSunset[i] = r.twilightSunset;
+        presult->pnoon[i] = r.noon;
+        presult->pdaylength[i] = r.daylength;
+        presult->pdeclination[i] = r.declination;
+        presult->pmaxAltitude[i] = r.maxAltitude;
+    }
+}
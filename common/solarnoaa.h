@@ -0,0 +1,93 @@
+// solarnoaa.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SOLARNOAA__INCLUDED_)
+#define VSCPAUTOMATION_SOLARNOAA__INCLUDED_
+
+#include <stddef.h>
+
+#include "solarbatch.h"
+#include "solarcalc.h"
+
+// High accuracy sunrise/sunset calculation
+//
+// The algorithm of the NOAA solar calculator (Meeus, Astronomical
+// Algorithms chapters 25 and 28) with nutation and aberration. The sun
+// position is calculated again at each event until it settles so sunrise
+// and sunset are not based on the position at noon. Sunrise/sunset is for
+// the upper limb at an altitude of -0.833 degrees and civil twilight at
+// -6 degrees. Accuracy is about one minute at latitudes below 72 degrees.
+//
+// Results are in the same form as from solar_calculate. Times are wrapped
+// to 0-24 local hours. Daylength is 24 hours and sunrise/sunset twelve
+// hours from noon if the sun never sets and the times are NaN if it never
+// rises, as with solar_calculate. All functions are pure.
+
+/*!
+    Calculate sunrise/sunset times for a date and a location
+    @param year Year
+    @param month Month 1-12
+    @param day Day 1-31
+    @param latitude Latitude in degrees, north positive
+    @param longitude Longitude in degrees, east positive
+    @param tzone Offset from UTC in hours
+    @param presult Pointer to structure that will get the result
+*/
+void
+solar_calculateNoaa(int year,
+                    int month,
+                    int day,
+                    double latitude,
+                    double longitude,
+                    double tzone,
+                    solarResult *presult);
+
+/*!
+    Same as solar_calculateNoaa with the day given as days to J2000
+    for UT midnight (solar_dayNumber(year, month, day, 0))
+*/
+void
+solar_calculateNoaaDay(double d,
+                       double latitude,
+                       double longitude,
+                       double tzone,
+                       solarResult *presult);
+
+/*!
+    Calculate many day/location tuples. Arguments as for
+    solar_calculateBatch.
+*/
+void
+solar_calculateNoaaBatch(size_t cnt,
+                         const double *pday,
+                         const double *platitude,
+                         const double *plongitude,
+                         const double *ptzone,
+                         const solarBatchResult *presult);
+
+#endif
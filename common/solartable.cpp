@@ -0,0 +1,389 @@
+// solartable.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <math.h>
+
+#include "solartable.h"
+
+// The table is calculated by the compiler with the functions below. They
+// are constexpr versions of the libm functions used by solar_calculateDay
+// and agree with them to a few ulp.
+
+// Cody-Waite split of pi/2
+#define CT_PIO2_1 1.57079625129699707031E0
+#define CT_PIO2_2 7.54978941586159635336E-8
+#define CT_PIO2_3 5.39030285815811905290E-15
+
+#define CT_PI 3.14159265358979323846
+
+// Number of days in the table
+#define SOLARTABLE_DAYS                                                        \
+    (ct_daysFromCivil(SOLARTABLE_LAST_YEAR + 1, 1, 1) -                        \
+     ct_daysFromCivil(SOLARTABLE_FIRST_YEAR, 1, 1))
+
+// Days since 1970-01-01 for a date (proleptic Gregorian)
+static constexpr long
+ct_daysFromCivil(long y, long m, long d)
+{
+    y -= (m <= 2) ? 1 : 0;
+    long era = ((y >= 0) ? y : y - 399) / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (m + ((m > 2) ? -3 : 9)) + 2) / 5 + d - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static constexpr double
+ct_floor(double x)
+{
+    double i = (double)(long long)x;
+    return (x < i) ? i - 1 : i;
+}
+
+struct ctSinCos
+{
+    double s;
+    double c;
+};
+
+static constexpr ctSinCos
+ct_sincos(double x)
+{
+    double q = ct_floor(x * (2.0 / CT_PI) + 0.5);
+    double r = ((x - q * CT_PIO2_1) - q * CT_PIO2_2) - q * CT_PIO2_3;
+    double z = r * r;
+
+    double ps = 1.58962301576546568060E-10;
+    ps = ps * z - 2.50507477628578072866E-8;
+    ps = ps * z + 2.75573136213857245213E-6;
+    ps = ps * z - 1.98412698295895385996E-4;
+    ps = ps * z + 8.33333333332211858878E-3;
+    ps = ps * z - 1.66666666666666307295E-1;
+    double sr = r + r * z * ps;
+
+    double pc = -1.13585365213876817300E-11;
+    pc = pc * z + 2.08757008419747316778E-9;
+    pc = pc * z - 2.75573141792967388112E-7;
+    pc = pc * z + 2.48015872888517045348E-5;
+    pc = pc * z - 1.38888888888730564116E-3;
+    pc = pc * z + 4.16666666666665929218E-2;
+    double cr = 1.0 - 0.5 * z + z * z * pc;
+
+    ctSinCos sc = { 0, 0 };
+    switch (((long long)q) & 3) {
+        case 0:
+            sc.s = sr;
+            sc.c = cr;
+            break;
+        case 1:
+            sc.s = cr;
+            sc.c = -sr;
+            break;
+        case 2:
+            sc.s = -sr;
+            sc.c = -cr;
+            break;
+        default:
+            sc.s = -cr;
+            sc.c = sr;
+            break;
+    }
+
+    return sc;
+}
+
+static constexpr double
+ct_atan(double x)
+{
+    double sign = (x < 0) ? -1.0 : 1.0;
+    double ax = x * sign;
+    double y0 = 0;
+    double extra = 0;
+
+    if (ax > 2.41421356237309504880) {
+        y0 = CT_PI / 2;
+        extra = 6.12323399573676588613E-17;
+        ax = -1.0 / ax;
+    } else if (ax > 0.66) {
+        y0 = CT_PI / 4;
+        extra = 0.5 * 6.12323399573676588613E-17;
+        ax = (ax - 1.0) / (ax + 1.0);
+    }
+
+    double z = ax * ax;
+    double p = -8.750608600031904122785E-1;
+    p = p * z - 1.615753718733365076637E1;
+    p = p * z - 7.500855792314704667340E1;
+    p = p * z - 1.228866684490136173410E2;
+    p = p * z - 6.485021904942025371773E1;
+    double q = z + 2.485846490142306297962E1;
+    q = q * z + 1.650270098316988542046E2;
+    q = q * z + 4.328810604912902668951E2;
+    q = q * z + 4.853903996359136964868E2;
+    q = q * z + 1.945506571482613964425E2;
+
+    return sign * (y0 + (ax * z * p / q + ax + extra));
+}
+
+static constexpr double
+ct_atan2(double y, double x)
+{
+    double a = ct_atan(y / x);
+    if (x < 0) {
+        a += (y >= 0) ? CT_PI : -CT_PI;
+    }
+    return a;
+}
+
+static constexpr double
+ct_sqrt(double x)
+{
+    double r = (x > 1.0) ? x : 1.0;
+    for (int i = 0; i < 64; i++) {
+        double n = 0.5 * (r + x / r);
+        if (n >= r) {
+            break;
+        }
+        r = n;
+    }
+    return r;
+}
+
+static constexpr double
+ct_asin(double x)
+{
+    return ct_atan2(x, ct_sqrt((1.0 - x) * (1.0 + x)));
+}
+
+// Same as range() in solarcalc.cpp
+static constexpr double
+ct_range(double x)
+{
+    double b = 0.5 * x / SOLAR_PI;
+    double a = 2.0 * SOLAR_PI * (b - (long)(b));
+    return (a < 0) ? 2.0 * SOLAR_PI + a : a;
+}
+
+// Same as the location independent part of solar_calculateDay
+static constexpr solarDayTerms
+ct_dayTerms(double d)
+{
+    double L = ct_range(280.461 * SOLAR_RADS + .9856474 * SOLAR_RADS * d);
+    double g = ct_range(357.528 * SOLAR_RADS + .9856003 * SOLAR_RADS * d);
+    double lambda = ct_range(L + 1.915 * SOLAR_RADS * ct_sincos(g).s +
+                             .02 * SOLAR_RADS * ct_sincos(2 * g).s);
+    double obliq = 23.439 * SOLAR_RADS - 0.0000004 * SOLAR_RADS * d;
+
+    ctSinCos sl = ct_sincos(lambda);
+    ctSinCos so = ct_sincos(obliq);
+    double alpha = ct_atan2(so.c * sl.s, sl.c);
+
+    solarDayTerms terms = { 0, 0 };
+    terms.declination = ct_asin(so.s * sl.s);
+
+    double LL = L - alpha;
+    if (L < SOLAR_PI) {
+        LL += 2.0 * SOLAR_PI;
+    }
+    terms.equation = 1440.0 * (1.0 - LL / SOLAR_PI / 2.0);
+
+    return terms;
+}
+
+struct solarTable
+{
+    solarDayTerms day[SOLARTABLE_DAYS];
+
+    constexpr solarTable()
+      : day()
+    {
+        long first = ct_daysFromCivil(SOLARTABLE_FIRST_YEAR, 1, 1);
+        for (long i = 0; i < SOLARTABLE_DAYS; i++) {
+            // Days since 1970-01-01 to days since J2000, see solar_dayNumber
+            day[i] = ct_dayTerms((double)(first + i) - 10957.5);
+        }
+    }
+};
+
+// Calculated at compile time and stored read only in the library
+static constexpr solarTable g_solarTable;
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_getDayTerms
+//
+
+const solarDayTerms *
+solar_getDayTerms(int year, int month, int day)
+{
+    if ((year < SOLARTABLE_FIRST_YEAR) || (year > SOLARTABLE_LAST_YEAR) ||
+        (month < 1) || (month > 12) || (day < 1) || (day > 31)) {
+        return NULL;
+    }
+
+    long idx = ct_daysFromCivil(year, month, day) -
+               ct_daysFromCivil(SOLARTABLE_FIRST_YEAR, 1, 1);
+    if ((idx < 0) || (idx >= SOLARTABLE_DAYS)) {
+        return NULL;
+    }
+
+    return &g_solarTable.day[idx];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// finish
+//
+// The location dependent part of solar_calculateDay. tanDh0 and tanDh1 are
+// the tangents of the declination corrected for the sun radius/refraction
+// and for civil twilight, with the sign for the hemisphere of the site.
+//
+
+static void
+finish(const solarDayTerms *pterms,
+       double tanDh0,
+       double tanDh1,
+       double latitude,
+       double longitude,
+       double tzone,
+       solarResult *presult)
+{
+    double tanLat = tan(latitude * SOLAR_RADS);
+
+    double fo = tanDh0 * tanLat;
+    if (fo > 0.99999)
+        fo = 1.0; // to avoid overflow //
+    double ha = asin(fo) + SOLAR_PI / 2.0;
+
+    double fi = tanDh1 * tanLat;
+    if (fi > 0.99999)
+        fi = 1.0;
+    double hb = asin(fi) + SOLAR_PI / 2.0;
+
+    double twx = 12.0 * (hb - ha) / SOLAR_PI;
+
+    presult->daylength = SOLAR_DEGS * ha / 7.5;
+    if (presult->daylength < 0.0001) {
+        presult->daylength = 0.0;
+    }
+
+    presult->sunrise = 12.0 - 12.0 * ha / SOLAR_PI + tzone - longitude / 15.0 +
+                       pterms->equation / 60.0;
+    presult->sunset = 12.0 + 12.0 * ha / SOLAR_PI + tzone - longitude / 15.0 +
+                      pterms->equation / 60.0;
+    presult->noon = presult->sunrise + 12.0 * ha / SOLAR_PI;
+
+    presult->declination = pterms->declination * SOLAR_DEGS;
+    presult->maxAltitude = 90.0 + presult->declination - latitude;
+    if (latitude < presult->declination)
+        presult->maxAltitude = 180.0 - presult->maxAltitude;
+
+    presult->twilightSunrise = presult->sunrise - twx;
+    presult->twilightSunset = presult->sunset + twx;
+
+    if (presult->sunrise > 24.0)
+        presult->sunrise -= 24.0;
+    if (presult->sunset > 24.0)
+        presult->sunset -= 24.0;
+    if (presult->twilightSunrise > 24.0)
+        presult->twilightSunrise -= 24.0;
+    if (presult->twilightSunset > 24.0)
+        presult->twilightSunset -= 24.0;
+}
+
+// Corrections of the sun altitude, see solar_calculateDay
+#define DH_SUNRISE  (SOLAR_RADS * (0.5 * SOLAR_SUN_DIA + SOLAR_AIR_REFR))
+#define DH_TWILIGHT (SOLAR_RADS * 6.0)
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateFromTerms
+//
+
+void
+solar_calculateFromTerms(const solarDayTerms *pterms,
+                         double latitude,
+                         double longitude,
+                         double tzone,
+                         solarResult *presult)
+{
+    if ((NULL == pterms) || (NULL == presult)) {
+        return;
+    }
+
+    // Correction: different sign at S HS
+    double sign = (latitude < 0.0) ? -1.0 : 1.0;
+    finish(pterms,
+           tan(pterms->declination + sign * DH_SUNRISE),
+           tan(pterms->declination + sign * DH_TWILIGHT),
+           latitude,
+           longitude,
+           tzone,
+           presult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// solar_calculateSitesFromTerms
+//
+
+void
+solar_calculateSitesFromTerms(const solarDayTerms *pterms,
+                              size_t cnt,
+                              const double *platitude,
+                              const double *plongitude,
+                              const double *ptzone,
+                              const solarBatchResult *presult)
+{
+    if ((NULL == pterms) || (NULL == platitude) || (NULL == plongitude) ||
+        (NULL == ptzone) || (NULL == presult)) {
+        return;
+    }
+
+    // The same for all sites, for the north and south hemisphere
+    double tanNorth0 = tan(pterms->declination + DH_SUNRISE);
+    double tanNorth1 = tan(pterms->declination + DH_TWILIGHT);
+    double tanSouth0 = tan(pterms->declination - DH_SUNRISE);
+    double tanSouth1 = tan(pterms->declination - DH_TWILIGHT);
+
+    for (size_t i = 0; i < cnt; i++) {
+        solarResult r;
+        bool bSouth = (platitude[i] < 0.0);
+        finish(pterms,
+               bSouth ? tanSouth0 : tanNorth0,
+               bSouth ? tanSouth1 : tanNorth1,
+               platitude[i],
+               plongitude[i],
+               ptzone[i],
+               &r);
+        presult->psunrise[i] = r.sunrise;
+        presult->psunset[i] = r.sunset;
+        presult->ptwilightSunrise[i] = r.twilightSunrise;
+        presult->ptwilightSunset[i] = r.twilightSunset;
+        presult->pnoon[i] = r.noon;
+        presult->pdaylength[i] = r.daylength;
+        presult->pdeclination[i] = r.declination;
+        presult->pmaxAltitude[i] = r.maxAltitude;
+    }
+}
@@ -0,0 +1,95 @@
+// solartable.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SOLARTABLE__INCLUDED_)
+#define VSCPAUTOMATION_SOLARTABLE__INCLUDED_
+
+#include <stddef.h>
+
+#include "solarbatch.h"
+#include "solarcalc.h"
+
+// Years covered by the compile time table
+#define SOLARTABLE_FIRST_YEAR 2020
+#define SOLARTABLE_LAST_YEAR  2039
+
+/*!
+    Location independent terms for one day. Calculated for UT
+    midnight (solar_dayNumber(year, month, day, 0)).
+*/
+struct solarDayTerms
+{
+    double declination; // Declination of the sun in radians
+    double equation;    // Equation of time in minutes
+};
+
+/*!
+    Get the terms for a day from the table
+    @param year Year
+    @param month Month 1-12
+    @param day Day 1-31
+    @return Pointer to terms or NULL if the day is not in the table
+*/
+const solarDayTerms *
+solar_getDayTerms(int year, int month, int day);
+
+/*!
+    Calculate sunrise/sunset times for a location from the terms
+    of a day. Gives the same result as solar_calculate for hour zero.
+    @param pterms Terms for the day
+    @param latitude Latitude in degrees
+    @param longitude Longitude in degrees
+    @param tzone Offset from UTC in hours
+    @param presult Pointer to structure that will get the result
+*/
+void
+solar_calculateFromTerms(const solarDayTerms *pterms,
+                         double latitude,
+                         double longitude,
+                         double tzone,
+                         solarResult *presult);
+
+/*!
+    Calculate sunrise/sunset times for many locations for the
+    same day.
+    @param pterms Terms for the day
+    @param cnt Number of locations
+    @param platitude Latitudes in degrees
+    @param plongitude Longitudes in degrees
+    @param ptzone Offsets from UTC in hours
+    @param presult Output arrays
+*/
+void
+solar_calculateSitesFromTerms(const solarDayTerms *pterms,
+                              size_t cnt,
+                              const double *platitude,
+                              const double *plongitude,
+                              const double *ptzone,
+                              const solarBatchResult *presult);
+
+#endif
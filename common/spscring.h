@@ -0,0 +1,427 @@
+// spscring.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_SPSCRING__INCLUDED_)
+#define VSCPAUTOMATION_SPSCRING__INCLUDED_
+
+#include <atomic>
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Size of a cache line. Producer and consumer state is kept on
+// separate lines so they do not invalidate each other.
+#define SPSCRING_CACHE_LINE 64
+
+///////////////////////////////////////////////////////////////////////////////
+// Bounded lock-free single producer ring
+//
+// One thread may push while any number of threads pop at the same time
+// without any locks. A consumer that finds the ring empty can park in
+// popWait() on a futex. The producer only makes the wake system call
+// when a consumer is actually parked, and then wakes all of them. The
+// producer can in the same way wait in waitRoom() for consumers to make
+// room.
+//
+// The producer may also drop the oldest item to make room. Both sides
+// therefore claim items with a compare-and-swap on the head and items are
+// stored as atomics so a claim that loses the race never sees a torn item.
+// T must be trivially copyable (pointers in practice).
+//
+
+template<typename T>
+class CSpscRing
+{
+
+  public:
+    /*!
+        Constructor
+        @param capacity Max number of items. Rounded up to a power of two.
+    */
+    explicit CSpscRing(size_t capacity)
+      : m_buf(NULL)
+    {
+        setCapacity(capacity);
+        m_waiters.store(0, std::memory_order_relaxed);
+        m_futex.store(0, std::memory_order_relaxed);
+        m_bClosed.store(false, std::memory_order_relaxed);
+        m_roomWaiter.store(0, std::memory_order_relaxed);
+        m_roomFutex.store(0, std::memory_order_relaxed);
+    };
+
+    /// Destructor
+    ~CSpscRing(void) { delete[] m_buf; };
+
+    /*!
+        Change the capacity. Items in the ring are lost. Only allowed
+        while no other thread uses the ring.
+        @param capacity Max number of items. Rounded up to a power of two.
+    */
+    void setCapacity(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        delete[] m_buf;
+        m_buf = new std::atomic<T>[size];
+        m_mask = size - 1;
+
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_cachedHead = 0;
+    };
+
+    /// Max number of items in the ring
+    size_t capacity(void) const { return m_mask + 1; };
+
+    /// Approximate number of items in the ring
+    size_t size(void) const
+    {
+        // Head first, it can never pass a tail read later
+        size_t head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    };
+
+    /// True if the ring is empty
+    bool empty(void) const
+    {
+        return m_head.load(std::memory_order_relaxed) ==
+               m_tail.load(std::memory_order_acquire);
+    };
+
+    /*!
+        Add an item. Producer side only. Consumers are not woken,
+        call notify() when done pushing.
+        @param item Item to add
+        @return true on success, false if the ring is full
+    */
+    bool push(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if ((tail - m_cachedHead) > m_mask) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if ((tail - m_cachedHead) > m_mask) {
+                return false;
+            }
+        }
+
+        m_buf[tail & m_mask].store(item, std::memory_order_relaxed);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    };
+
+    /*!
+        Wait until there are fewer than limit items in the ring.
+        Producer side. The consumer that makes room wakes us.
+        @param limit Max number of items to wait for
+        @param end Time (CLOCK_MONOTONIC) when to give up, see
+                makeDeadline()
+        @return true if there is room, false on timeout
+    */
+    bool waitRoom(size_t limit, const struct timespec& end)
+    {
+        struct timespec rel;
+
+        while (true) {
+
+            uint32_t seq = m_roomFutex.load(std::memory_order_acquire);
+
+            // Pairs with the head update and waiter check in pop().
+            // Either we see the new head or the consumer sees us.
+            m_roomWaiter.store(1, std::memory_order_seq_cst);
+            size_t head = m_head.load(std::memory_order_seq_cst);
+            if ((m_tail.load(std::memory_order_relaxed) - head) < limit) {
+                m_roomWaiter.store(0, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (!timeLeft(end, rel)) {
+                m_roomWaiter.store(0, std::memory_order_relaxed);
+                return false;
+            }
+
+            syscall(SYS_futex,
+                    reinterpret_cast<uint32_t*>(&m_roomFutex),
+                    FUTEX_WAIT_PRIVATE,
+                    seq,
+                    &rel,
+                    NULL,
+                    0);
+        }
+    };
+
+    /*!
+        Remove the oldest item to make room. Producer side.
+        @param item Reference to item that get the removed item
+        @return true on success, false if the ring is empty
+    */
+    bool dropOldest(T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+
+        do {
+            if (head == tail) {
+                return false;
+            }
+            item = m_buf[head & m_mask].load(std::memory_order_relaxed);
+        } while (!m_head.compare_exchange_weak(
+          head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        return true;
+    };
+
+    /*!
+        Check if any item waiting in the ring matches. Producer side.
+        Items may be popped by consumers while looking.
+        @param pred Called with each item until it returns true
+        @return true if pred returned true for an item
+    */
+    template<typename Pred>
+    bool findQueued(Pred pred) const
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        for (size_t i = m_head.load(std::memory_order_acquire); i != tail; i++) {
+            if (pred(m_buf[i & m_mask].load(std::memory_order_relaxed))) {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    /*!
+        Wake the consumers parked in popWait(). Producer side.
+    */
+    void notify(void)
+    {
+        // Pairs with the fence in popWait(). Either we see the
+        // waiter count or the consumer sees the new tail.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed)) {
+            m_futex.fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex,
+                    reinterpret_cast<uint32_t*>(&m_futex),
+                    FUTEX_WAKE_PRIVATE,
+                    INT_MAX,
+                    NULL,
+                    NULL,
+                    0);
+        }
+    };
+
+    /*!
+        Wake the consumers and make popWait() return at once when the
+        ring is empty from now on. Items can still be pushed and popped.
+        May be called from any thread.
+    */
+    void close(void)
+    {
+        m_bClosed.store(true, std::memory_order_relaxed);
+        notify();
+    };
+
+    /*!
+        Remove an item. Consumer side, may be called from several
+        threads at the same time.
+        @param item Reference to item that get the removed item
+        @return true on success, false if the ring is empty
+    */
+    bool pop(T& item)
+    {
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+
+        do {
+            // Other consumers and items dropped by the producer can
+            // move the head past the tail we read
+            if ((ptrdiff_t)(tail - head) <= 0) {
+                tail = m_tail.load(std::memory_order_acquire);
+                if ((ptrdiff_t)(tail - head) <= 0) {
+                    return false;
+                }
+            }
+            item = m_buf[head & m_mask].load(std::memory_order_relaxed);
+        } while (!m_head.compare_exchange_weak(
+          head, head + 1, std::memory_order_seq_cst, std::memory_order_acquire));
+
+        // Wake the producer if it waits for room in waitRoom()
+        if (m_roomWaiter.load(std::memory_order_seq_cst)) {
+            m_roomFutex.fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex,
+                    reinterpret_cast<uint32_t*>(&m_roomFutex),
+                    FUTEX_WAKE_PRIVATE,
+                    1,
+                    NULL,
+                    NULL,
+                    0);
+        }
+
+        return true;
+    };
+
+    /*!
+        Remove an item, wait for one if the ring is empty.
+        Consumer side, may be called from several threads at the
+        same time.
+        @param item Reference to item that get the removed item
+        @param timeout Max time to wait in milliseconds
+        @return true on success, false on timeout or if the ring
+                is closed and empty
+    */
+    bool popWait(T& item, uint32_t timeout)
+    {
+        struct timespec end, rel;
+
+        if (pop(item)) {
+            return true;
+        }
+
+        if (!timeout) {
+            return false;
+        }
+
+        makeDeadline(end, timeout);
+
+        // Counted so one consumer leaving does not hide the others
+        // from notify()
+        m_waiters.fetch_add(1, std::memory_order_relaxed);
+
+        while (true) {
+
+            uint32_t seq = m_futex.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // Recheck after announcing that we are going to park
+            if (pop(item)) {
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Pairs with the fence in notify() called from close()
+            if (m_bClosed.load(std::memory_order_relaxed)) {
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (!timeLeft(end, rel)) {
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            // Returns at once (EAGAIN) if the producer has
+            // notified since we read the sequence.
+            syscall(SYS_futex,
+                    reinterpret_cast<uint32_t*>(&m_futex),
+                    FUTEX_WAIT_PRIVATE,
+                    seq,
+                    &rel,
+                    NULL,
+                    0);
+        }
+    };
+
+    /*!
+        Get the time (CLOCK_MONOTONIC) a timeout from now. Used for
+        waits that are not affected by changes of the system clock.
+        @param end Gets the time
+        @param timeout Time from now in milliseconds
+    */
+    static void makeDeadline(struct timespec& end, uint32_t timeout)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        end.tv_sec += timeout / 1000;
+        end.tv_nsec += (timeout % 1000) * 1000000L;
+        if (end.tv_nsec >= 1000000000L) {
+            end.tv_sec++;
+            end.tv_nsec -= 1000000000L;
+        }
+    };
+
+  private:
+    /// Time left until a deadline from makeDeadline(), false if passed
+    static bool timeLeft(const struct timespec& end, struct timespec& rel)
+    {
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        rel.tv_sec = end.tv_sec - now.tv_sec;
+        rel.tv_nsec = end.tv_nsec - now.tv_nsec;
+        if (rel.tv_nsec < 0) {
+            rel.tv_sec--;
+            rel.tv_nsec += 1000000000L;
+        }
+
+        return (rel.tv_sec >= 0);
+    };
+
+  private:
+    // Not copyable
+    CSpscRing(const CSpscRing&);
+    CSpscRing& operator=(const CSpscRing&);
+
+  private:
+    /// Item storage
+    std::atomic<T>* m_buf;
+
+    /// Capacity - 1
+    size_t m_mask;
+
+    // Padding is used instead of alignas as the owning objects are
+    // allocated with new which does not honour extended alignment
+    // before C++17.
+    char m_pad0[SPSCRING_CACHE_LINE];
+
+    // Consumer side. Shared by all consumers so the tail is not cached.
+    std::atomic<size_t> m_head;
+    char m_pad1[SPSCRING_CACHE_LINE - sizeof(size_t)];
+
+    // Producer side
+    std::atomic<size_t> m_tail;
+    size_t m_cachedHead;
+    char m_pad2[SPSCRING_CACHE_LINE - 2 * sizeof(size_t)];
+
+    // Parking
+    std::atomic<uint32_t> m_waiters; // Number of parked consumers
+    std::atomic<uint32_t> m_futex;
+    std::atomic<bool> m_bClosed;
+
+    // Producer waiting for room
+    std::atomic<uint32_t> m_roomWaiter;
+    std::atomic<uint32_t> m_roomFutex;
+};
+
+#endif
@@ -0,0 +1,655 @@
+// tzinfo.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <algorithm>
+#include <map>
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+
+#include "tzinfo.h"
+
+// Loaded zones, never freed
+static pthread_mutex_t g_mutexZones = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, CTimeZone*> g_zones;
+static std::map<int32_t, CTimeZone*> g_fixedZones;
+
+// Big endian integers in a tzfile
+static int64_t
+readBe(const unsigned char* p, int size)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < size; i++) {
+        v = (v << 8) | p[i];
+    }
+
+    // Sign extend
+    if (size < 8) {
+        v = (v ^ ((uint64_t)1 << (size * 8 - 1))) - ((uint64_t)1 << (size * 8 - 1));
+    }
+
+    return (int64_t)v;
+}
+
+// Division rounded down, also for negative values
+static int64_t
+floorDiv(int64_t a, int64_t b)
+{
+    return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+}
+
+static bool
+isLeapYear(int year)
+{
+    return (0 == (year % 4)) && ((0 != (year % 100)) || (0 == (year % 400)));
+}
+
+static int
+daysInMonth(int year, int month)
+{
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return days[month - 1] + (((2 == month) && isLeapYear(year)) ? 1 : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+//
+
+CTimeZone::CTimeZone(void)
+{
+    m_initialOffset = 0;
+    m_bRule = false;
+    m_bRuleDst = false;
+    m_ruleStdOffset = 0;
+    m_ruleDstOffset = 0;
+    for (int i = 0; i < 2; i++) {
+        m_ruleType[i] = 'M';
+        m_ruleMonth[i] = 1;
+        m_ruleWeek[i] = 1;
+        m_ruleDay[i] = 0;
+        m_ruleTime[i] = 7200;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// get
+//
+
+const CTimeZone*
+CTimeZone::get(const std::string& name)
+{
+    CTimeZone* pzone = NULL;
+
+    pthread_mutex_lock(&g_mutexZones);
+
+    std::map<std::string, CTimeZone*>::iterator it = g_zones.find(name);
+    if (it != g_zones.end()) {
+        pthread_mutex_unlock(&g_mutexZones);
+        return it->second;
+    }
+
+    const char* pdir = getenv("TZDIR");
+    std::string dir = (NULL != pdir) ? pdir : TZINFO_DEFAULT_DIR;
+
+    pzone = new CTimeZone;
+    bool rv = false;
+
+    if (name.empty()) {
+
+        // Zone of the host, as localtime() would do
+        const char* ptz = getenv("TZ");
+        if (NULL == ptz) {
+            rv = pzone->loadFile("/etc/localtime");
+        } else {
+            if (':' == *ptz) {
+                ptz++;
+            }
+            if (!*ptz) {
+                rv = true; // UTC
+            } else if ('/' == *ptz) {
+                rv = pzone->loadFile(ptz);
+            } else {
+                rv = pzone->loadFile(dir + "/" + ptz) || pzone->parseRule(ptz);
+                if (rv && pzone->m_bRule && pzone->m_when.empty()) {
+                    pzone->addRuleTransitions();
+                }
+            }
+        }
+
+        if (!rv) {
+            syslog(LOG_ERR,
+                   "[vscpl2drv-automation] Unable to read the time zone of "
+                   "the host. UTC will be used.");
+            delete pzone;
+            pzone = new CTimeZone;
+        }
+        rv = true;
+
+    } else if (std::string::npos == name.find("..")) {
+        rv = pzone->loadFile(('/' == name[0]) ? name : (dir + "/" + name));
+    }
+
+    if (!rv) {
+        syslog(LOG_ERR,
+               "[vscpl2drv-automation] Unable to read time zone [%s].",
+               name.c_str());
+        delete pzone;
+        pzone = NULL;
+    } else {
+        pzone->m_name = name;
+        g_zones[name] = pzone;
+    }
+
+    pthread_mutex_unlock(&g_mutexZones);
+
+    return pzone;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getFixed
+//
+
+const CTimeZone*
+CTimeZone::getFixed(int32_t offset)
+{
+    CTimeZone* pzone;
+
+    pthread_mutex_lock(&g_mutexZones);
+
+    std::map<int32_t, CTimeZone*>::iterator it = g_fixedZones.find(offset);
+    if (it != g_fixedZones.end()) {
+        pzone = it->second;
+    } else {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "UTC%+.2f", offset / 3600.0);
+        pzone = new CTimeZone;
+        pzone->m_name = buf;
+        pzone->m_initialOffset = offset;
+        g_fixedZones[offset] = pzone;
+    }
+
+    pthread_mutex_unlock(&g_mutexZones);
+
+    return pzone;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadFile
+//
+
+bool
+CTimeZone::loadFile(const std::string& path)
+{
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (NULL == fp) {
+        return false;
+    }
+
+    std::vector<unsigned char> buf;
+    unsigned char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        buf.insert(buf.end(), chunk, chunk + n);
+    }
+    fclose(fp);
+
+    const size_t hdrSize = 44;
+    if ((buf.size() < hdrSize) || memcmp(&buf[0], "TZif", 4)) {
+        return false;
+    }
+
+    // Version 2 and later repeat the data with 64-bit times after
+    // the version 1 data, followed by a rule for later times
+    size_t pos = 0;
+    int timeSize = 4;
+    for (int pass = 0; pass < 2; pass++) {
+
+        if ((pos + hdrSize) > buf.size()) {
+            return false;
+        }
+
+        const unsigned char* phdr = &buf[pos];
+        uint32_t isutcnt = (uint32_t)readBe(phdr + 20, 4);
+        uint32_t isstdcnt = (uint32_t)readBe(phdr + 24, 4);
+        uint32_t leapcnt = (uint32_t)readBe(phdr + 28, 4);
+        uint32_t timecnt = (uint32_t)readBe(phdr + 32, 4);
+        uint32_t typecnt = (uint32_t)readBe(phdr + 36, 4);
+        uint32_t charcnt = (uint32_t)readBe(phdr + 40, 4);
+
+        size_t dataSize = (size_t)timecnt * timeSize + timecnt + typecnt * 6 +
+                          charcnt + leapcnt * (timeSize + 4) + isstdcnt +
+                          isutcnt;
+
+        if ((pos + hdrSize + dataSize) > buf.size()) {
+            return false;
+        }
+
+        if ((0 == pass) && (phdr[4] >= '2')) {
+            pos += hdrSize + dataSize;
+            timeSize = 8;
+            continue;
+        }
+
+        if (!typecnt) {
+            return false;
+        }
+
+        const unsigned char* ptimes = phdr + hdrSize;
+        const unsigned char* pidx = ptimes + timecnt * timeSize;
+        const unsigned char* ptypes = pidx + timecnt;
+
+        m_when.clear();
+        m_offset.clear();
+        for (uint32_t i = 0; i < timecnt; i++) {
+            if (pidx[i] >= typecnt) {
+                return false;
+            }
+            m_when.push_back(readBe(ptimes + i * timeSize, timeSize));
+            m_offset.push_back((int32_t)readBe(ptypes + pidx[i] * 6, 4));
+        }
+
+        // Type zero is used before the first transition
+        m_initialOffset = (int32_t)readBe(ptypes, 4);
+
+        // Rule for times after the last transition
+        pos += hdrSize + dataSize;
+        if ((8 == timeSize) && (pos < buf.size()) && ('\n' == buf[pos])) {
+            std::string rule;
+            for (size_t i = pos + 1; (i < buf.size()) && ('\n' != buf[i]); i++) {
+                rule += (char)buf[i];
+            }
+            if (!rule.empty() && !parseRule(rule.c_str())) {
+                syslog(LOG_ERR,
+                       "[vscpl2drv-automation] Time zone rule [%s] in [%s] "
+                       "not understood.",
+                       rule.c_str(),
+                       path.c_str());
+            }
+        }
+
+        break;
+    }
+
+    addRuleTransitions();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// parseRule
+//
+
+// Zone abbreviation, "CET" or "<+03>"
+static const char*
+parseRuleName(const char* p)
+{
+    if ('<' == *p) {
+        const char* pend = strchr(p, '>');
+        return (NULL == pend) ? NULL : (pend + 1);
+    }
+
+    const char* pstart = p;
+    while (isalpha((unsigned char)*p)) {
+        p++;
+    }
+
+    return (p == pstart) ? NULL : p;
+}
+
+// [+|-]hh[:mm[:ss]] in seconds
+static const char*
+parseRuleTime(const char* p, int32_t* psecs)
+{
+    int sign = 1;
+    if (('+' == *p) || ('-' == *p)) {
+        sign = ('-' == *p) ? -1 : 1;
+        p++;
+    }
+
+    if (!isdigit((unsigned char)*p)) {
+        return NULL;
+    }
+
+    int32_t secs = 0;
+    for (int part = 0; part < 3; part++) {
+        int v = 0;
+        while (isdigit((unsigned char)*p)) {
+            v = v * 10 + (*p++ - '0');
+        }
+        secs += v * ((0 == part) ? 3600 : ((1 == part) ? 60 : 1));
+        if ((':' != *p) || !isdigit((unsigned char)p[1])) {
+            break;
+        }
+        p++;
+    }
+
+    *psecs = sign * secs;
+    return p;
+}
+
+// Unsigned number
+static const char*
+parseRuleNumber(const char* p, int* pv)
+{
+    if (!isdigit((unsigned char)*p)) {
+        return NULL;
+    }
+
+    *pv = 0;
+    while (isdigit((unsigned char)*p)) {
+        *pv = *pv * 10 + (*p++ - '0');
+    }
+
+    return p;
+}
+
+bool
+CTimeZone::parseRule(const char* prule)
+{
+    int32_t secs;
+    const char* p = prule;
+
+    // Standard time, POSIX offsets are positive west of Greenwich
+    if ((NULL == (p = parseRuleName(p))) || (NULL == (p = parseRuleTime(p, &secs)))) {
+        return false;
+    }
+    m_ruleStdOffset = -secs;
+    m_ruleDstOffset = m_ruleStdOffset;
+    m_bRuleDst = false;
+
+    if (*p) {
+
+        // Daylight saving time, one hour ahead by default
+        if (NULL == (p = parseRuleName(p))) {
+            return false;
+        }
+        m_ruleDstOffset = m_ruleStdOffset + 3600;
+        if (*p && (',' != *p)) {
+            if (NULL == (p = parseRuleTime(p, &secs))) {
+                return false;
+            }
+            m_ruleDstOffset = -secs;
+        }
+
+        // Start and end of daylight saving time. The US rule is used
+        // if they are left out.
+        const char* pdates = (',' == *p) ? p : ",M3.2.0,M11.1.0";
+        for (int i = 0; i < 2; i++) {
+            if (',' != *pdates++) {
+                return false;
+            }
+
+            if ('M' == *pdates) {
+                m_ruleType[i] = 'M';
+                if ((NULL == (pdates = parseRuleNumber(pdates + 1, &m_ruleMonth[i]))) ||
+                    ('.' != *pdates) ||
+                    (NULL == (pdates = parseRuleNumber(pdates + 1, &m_ruleWeek[i]))) ||
+                    ('.' != *pdates) ||
+                    (NULL == (pdates = parseRuleNumber(pdates + 1, &m_ruleDay[i])))) {
+                    return false;
+                }
+                if ((m_ruleMonth[i] < 1) || (m_ruleMonth[i] > 12) ||
+                    (m_ruleWeek[i] < 1) || (m_ruleWeek[i] > 5) ||
+                    (m_ruleDay[i] > 6)) {
+                    return false;
+                }
+            } else if ('J' == *pdates) {
+                m_ruleType[i] = 'J';
+                if ((NULL == (pdates = parseRuleNumber(pdates + 1, &m_ruleDay[i]))) ||
+                    (m_ruleDay[i] < 1) || (m_ruleDay[i] > 365)) {
+                    return false;
+                }
+            } else {
+                m_ruleType[i] = 'N';
+                if ((NULL == (pdates = parseRuleNumber(pdates, &m_ruleDay[i]))) ||
+                    (m_ruleDay[i] > 365)) {
+                    return false;
+                }
+            }
+
+            m_ruleTime[i] = 7200;
+            if ('/' == *pdates) {
+                if (NULL == (pdates = parseRuleTime(pdates + 1, &m_ruleTime[i]))) {
+                    return false;
+                }
+            }
+        }
+
+        if (*pdates && (pdates != p)) {
+            return false;
+        }
+
+        m_bRuleDst = true;
+    }
+
+    m_bRule = true;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getRuleTime
+//
+
+int64_t
+CTimeZone::getRuleTime(int year, int rule) const
+{
+    int32_t days;
+
+    switch (m_ruleType[rule]) {
+
+        case 'M': {
+            // Day d of week w of month m, week 5 is the last
+            days = daysFromCivil(year, m_ruleMonth[rule], 1);
+            int wday = (int)(((days + 4) % 7 + 7) % 7); // 1970-01-01 was a Thursday
+            int mday = 1 + (m_ruleDay[rule] - wday + 7) % 7 + 7 * (m_ruleWeek[rule] - 1);
+            while (mday > daysInMonth(year, m_ruleMonth[rule])) {
+                mday -= 7;
+            }
+            days += mday - 1;
+        } break;
+
+        case 'J':
+            // 1-365, February 29 is never counted
+            days = daysFromCivil(year, 1, 1) + m_ruleDay[rule] - 1;
+            if (isLeapYear(year) && (m_ruleDay[rule] >= 60)) {
+                days++;
+            }
+            break;
+
+        default:
+            days = daysFromCivil(year, 1, 1) + m_ruleDay[rule];
+            break;
+    }
+
+    return (int64_t)days * 86400 + m_ruleTime[rule];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// addRuleTransitions
+//
+
+void
+CTimeZone::addRuleTransitions(void)
+{
+    if (!m_bRule) {
+        return;
+    }
+
+    // A zone that is only a rule
+    if (m_when.empty()) {
+        m_initialOffset = m_ruleStdOffset;
+    }
+
+    if (!m_bRuleDst) {
+        return;
+    }
+
+    // A year early so a rule with daylight saving time over new year
+    // is right from the start
+    int year = 1969;
+    if (!m_when.empty()) {
+        int month, day;
+        civilFromDays((int32_t)floorDiv(m_when.back(), 86400), &year, &month, &day);
+    }
+
+    // Start is given in standard time and end in daylight saving time
+    std::vector<std::pair<int64_t, int32_t> > rules;
+    for (int y = year; y <= TZINFO_LAST_YEAR; y++) {
+        rules.push_back(std::make_pair(getRuleTime(y, 0) - m_ruleStdOffset,
+                                       m_ruleDstOffset));
+        rules.push_back(std::make_pair(getRuleTime(y, 1) - m_ruleDstOffset,
+                                       m_ruleStdOffset));
+    }
+
+    // Equal times keep their order so the later rule wins the lookup
+    std::stable_sort(rules.begin(),
+                     rules.end(),
+                     [](const std::pair<int64_t, int32_t>& a,
+                        const std::pair<int64_t, int32_t>& b) {
+                         return a.first < b.first;
+                     });
+
+    int64_t last = m_when.empty() ? INT64_MIN : m_when.back();
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (rules[i].first > last) {
+            m_when.push_back(rules[i].first);
+            m_offset.push_back(rules[i].second);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getOffset
+//
+
+int32_t
+CTimeZone::getOffset(int64_t utc) const
+{
+    std::vector<int64_t>::const_iterator it =
+      std::upper_bound(m_when.begin(), m_when.end(), utc);
+
+    if (it == m_when.begin()) {
+        return m_initialOffset;
+    }
+
+    return m_offset[(it - m_when.begin()) - 1];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getLocalOffset
+//
+
+int32_t
+CTimeZone::getLocalOffset(int64_t local) const
+{
+    // The offset in effect just before the local time
+    int32_t offset = getOffset(local - getOffset(local));
+
+    // In a gap (the clock moved forward) the local time is not shown
+    // with either offset and the two guesses differ. The smaller one is
+    // the offset before the change.
+    int32_t check = getOffset(local - offset);
+    if (check < offset) {
+        return check;
+    }
+
+    return offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getLocalDate
+//
+
+int32_t
+CTimeZone::getLocalDate(int64_t utc, int* pyear, int* pmonth, int* pday) const
+{
+    int32_t days = (int32_t)floorDiv(utc + getOffset(utc), 86400);
+    civilFromDays(days, pyear, pmonth, pday);
+    return days;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getMidnight
+//
+
+int64_t
+CTimeZone::getMidnight(int year, int month, int day) const
+{
+    int64_t local = (int64_t)daysFromCivil(year, month, day) * 86400;
+    return local - getLocalOffset(local);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getNoonOffset
+//
+
+int32_t
+CTimeZone::getNoonOffset(int year, int month, int day) const
+{
+    return getLocalOffset((int64_t)daysFromCivil(year, month, day) * 86400 + 43200);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// daysFromCivil
+//
+
+int32_t
+CTimeZone::daysFromCivil(int year, int month, int day)
+{
+    year -= (month <= 2) ? 1 : 0;
+    int era = (int)floorDiv(year, 400);
+    int yoe = year - era * 400;
+    int doy = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// civilFromDays
+//
+
+void
+CTimeZone::civilFromDays(int32_t days, int* pyear, int* pmonth, int* pday)
+{
+    int64_t z = (int64_t)days + 719468;
+    int era = (int)floorDiv(z, 146097);
+    int doe = (int)(z - (int64_t)era * 146097);
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int month = (mp < 10) ? (mp + 3) : (mp - 9);
+
+    *pyear = yoe + era * 400 + ((month <= 2) ? 1 : 0);
+    *pmonth = month;
+    *pday = doy - (153 * mp + 2) / 5 + 1;
+}
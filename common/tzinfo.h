@@ -0,0 +1,173 @@
+// tzinfo.h
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#if !defined(VSCPAUTOMATION_TZINFO__INCLUDED_)
+#define VSCPAUTOMATION_TZINFO__INCLUDED_
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+// Directory with the IANA time zone files if TZDIR is not set
+#define TZINFO_DEFAULT_DIR "/usr/share/zoneinfo"
+
+// Transitions from the rule of a zone are precalculated up to this year
+#define TZINFO_LAST_YEAR 2100
+
+///////////////////////////////////////////////////////////////////////////////
+// Time zone
+//
+// A zone is read once from its tzfile into a sorted array of transitions.
+// Transitions after the last one in the file are made from the POSIX rule
+// at the end of the file, up to TZINFO_LAST_YEAR. Lookups are a binary
+// search and do not use the time zone functions of libc, which take a
+// global lock in glibc.
+//
+// Zones are shared by all users in the process and are never freed, so
+// the pointers from get() stay valid. A zone is not changed after it has
+// been loaded and can be used from any thread.
+//
+
+class CTimeZone
+{
+
+  public:
+    /*!
+        Get a zone, it is loaded the first time it is used
+        @param name IANA name (for example "Europe/Stockholm"), path
+                to a tzfile or empty for the zone of the host (TZ or
+                /etc/localtime, UTC if neither can be read)
+        @return Pointer to zone or NULL if it could not be loaded
+    */
+    static const CTimeZone *get(const std::string &name);
+
+    /*!
+        Get a zone with a fixed offset and no daylight saving time
+        @param offset Offset from UTC in seconds, east is positive
+        @return Pointer to zone
+    */
+    static const CTimeZone *getFixed(int32_t offset);
+
+    /*!
+        Get the offset from UTC at a time
+        @param utc Seconds since epoch
+        @return Offset in seconds, east is positive
+    */
+    int32_t getOffset(int64_t utc) const;
+
+    /*!
+        Get the offset from UTC for a local time. A local time that is
+        skipped when the clock is moved forward gets the offset before
+        the change.
+        @param local Local time as seconds since the local epoch
+        @return Offset in seconds, east is positive
+    */
+    int32_t getLocalOffset(int64_t local) const;
+
+    /*!
+        Get the local date at a time
+        @param utc Seconds since epoch
+        @param pyear Pointer to year
+        @param pmonth Pointer to month 1-12
+        @param pday Pointer to day 1-31
+        @return Local date as days since 1970-01-01
+    */
+    int32_t getLocalDate(int64_t utc, int *pyear, int *pmonth, int *pday) const;
+
+    /*!
+        Get the first moment of a local day
+        @param year Year
+        @param month Month 1-12
+        @param day Day 1-31
+        @return Seconds since epoch
+    */
+    int64_t getMidnight(int year, int month, int day) const;
+
+    /*!
+        Get the offset from UTC at local noon, used for the solar
+        calculations of a day
+        @param year Year
+        @param month Month 1-12
+        @param day Day 1-31
+        @return Offset in seconds, east is positive
+    */
+    int32_t getNoonOffset(int year, int month, int day) const;
+
+    /// Name the zone was loaded with
+    const std::string &getName(void) const { return m_name; };
+
+    /// Number of transitions (from the file and precalculated)
+    size_t getTransitionCount(void) const { return m_when.size(); };
+
+    /// Days since 1970-01-01 for a date
+    static int32_t daysFromCivil(int year, int month, int day);
+
+    /// Date for days since 1970-01-01
+    static void civilFromDays(int32_t days, int *pyear, int *pmonth, int *pday);
+
+  private:
+    CTimeZone(void);
+
+    /// Read a tzfile
+    bool loadFile(const std::string &path);
+
+    /// Parse a POSIX TZ rule, such as "CET-1CEST,M3.5.0,M10.5.0/3"
+    bool parseRule(const char *prule);
+
+    /// Add the transitions of the rule after the last one from the file
+    void addRuleTransitions(void);
+
+    /// Time for a rule date in a year, seconds since the local epoch
+    int64_t getRuleTime(int year, int rule) const;
+
+  private:
+    std::string m_name;
+
+    /// Transition times, sorted
+    std::vector<int64_t> m_when;
+
+    /// Offset from UTC from each transition
+    std::vector<int32_t> m_offset;
+
+    /// Offset before the first transition
+    int32_t m_initialOffset;
+
+    // POSIX rule, used after the last transition in the file
+    bool m_bRule;
+    bool m_bRuleDst;
+    int32_t m_ruleStdOffset;
+    int32_t m_ruleDstOffset;
+    char m_ruleType[2];   // 'M', 'J' or 'N' (zero based day of year)
+    int m_ruleMonth[2];
+    int m_ruleWeek[2];
+    int m_ruleDay[2];     // Weekday for 'M', day of year otherwise
+    int32_t m_ruleTime[2]; // Local time of day in seconds
+};
+
+#endif
@@ -0,0 +1,307 @@
+// bench-engine.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Accuracy and speed of the sunrise/sunset engines.
+//
+// Runs the legacy and the NOAA engine over a reference table and reports
+// the error distribution for each event and the number of calculations
+// per second for each engine.
+//
+// The reference is a text file with one line for each date and location
+//
+//   yyyy-mm-dd,latitude,longitude,sunrise,sunset
+//
+// with latitude north positive, longitude east positive and sunrise and
+// sunset as UTC hh:mm or hh:mm:ss ('-' if there is none). Lines starting
+// with '#' are comments. Times can for example be taken from the USNO or
+// NOAA web calculators for the sites in use.
+//
+// Without a reference file the NOAA engine is used as reference for a grid
+// of locations over all days of 2021. That shows how much the legacy
+// engine differs from the NOAA engine, not the true error of either.
+//
+// Usage: bench-engine [reference-file]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "solarcalc.h"
+#include "solarnoaa.h"
+
+// One reference date and location
+struct refEntry
+{
+    double day; // Days to J2000 for UT midnight
+    double latitude;
+    double longitude;
+    double sunrise; // UTC decimal hours, NaN if none
+    double sunset;
+};
+
+// Seconds from a monotonic clock
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Parse hh:mm[:ss] or '-'
+static bool
+parseTime(const char *str, double *phours)
+{
+    int h, m, s = 0;
+
+    if ('-' == *str) {
+        *phours = NAN;
+        return true;
+    }
+
+    if (sscanf(str, "%d:%d:%d", &h, &m, &s) < 2) {
+        return false;
+    }
+
+    *phours = h + m / 60.0 + s / 3600.0;
+    return true;
+}
+
+// Read a reference file
+static bool
+readReference(const char *path, std::vector<refEntry> &ref)
+{
+    char line[256];
+    int lineno = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (NULL == fp) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return false;
+    }
+
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        int y, m, d;
+        char rise[16], set[16];
+        refEntry e;
+
+        lineno++;
+        if (('#' == line[0]) || ('\n' == line[0]) || ('\r' == line[0])) {
+            continue;
+        }
+
+        if ((7 != sscanf(line,
+                         "%d-%d-%d,%lf,%lf,%15[^,],%15s",
+                         &y,
+                         &m,
+                         &d,
+                         &e.latitude,
+                         &e.longitude,
+                         rise,
+                         set)) ||
+            !parseTime(rise, &e.sunrise) || !parseTime(set, &e.sunset)) {
+            fprintf(stderr, "%s:%d: bad line\n", path, lineno);
+            fclose(fp);
+            return false;
+        }
+
+        e.day = solar_dayNumber(y, m, d, 0);
+        ref.push_back(e);
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// Grid of locations for every day of 2021 with NOAA times as reference
+static void
+makeReference(std::vector<refEntry> &ref)
+{
+    double day0 = solar_dayNumber(2021, 1, 1, 0);
+
+    for (int lat = -65; lat <= 65; lat += 5) {
+        for (int lon = -180; lon < 180; lon += 45) {
+            for (int d = 0; d < 365; d++) {
+                solarResult r;
+                refEntry e;
+                e.day = day0 + d;
+                e.latitude = lat;
+                e.longitude = lon;
+                solar_calculateNoaaDay(e.day, lat, lon, 0, &r);
+                e.sunrise = (r.daylength >= 24.0) ? NAN : r.sunrise;
+                e.sunset = (r.daylength >= 24.0) ? NAN : r.sunset;
+                ref.push_back(e);
+            }
+        }
+    }
+}
+
+// Difference in seconds between two times of day
+static double
+timeDiff(double a, double b)
+{
+    double diff = fmod(a - b + 36.0, 24.0) - 12.0;
+    return diff * 3600.0;
+}
+
+// Print the distribution of absolute errors in seconds
+static void
+report(const char *name, std::vector<double> &err, size_t missing)
+{
+    if (err.empty()) {
+        printf("  %-16s no values, %zu missing\n", name, missing);
+        return;
+    }
+
+    std::sort(err.begin(), err.end());
+
+    double sum = 0;
+    for (size_t i = 0; i < err.size(); i++) {
+        sum += err[i];
+    }
+
+    size_t n = err.size();
+    printf("  %-16s mean %6.1f  p50 %6.1f  p90 %6.1f  p99 %6.1f  max %6.1f s"
+           "  (%zu values, %zu missing)\n",
+           name,
+           sum / n,
+           err[n / 2],
+           err[(n * 9) / 10],
+           err[(n * 99) / 100],
+           err[n - 1],
+           n,
+           missing);
+}
+
+// Compare one engine with the reference
+static void
+compare(const char *name,
+        void (*calc)(double, double, double, double, solarResult *),
+        const std::vector<refEntry> &ref)
+{
+    std::vector<double> rise, set, riseEvent, setEvent;
+    size_t missing[2] = { 0, 0 };
+
+    for (size_t i = 0; i < ref.size(); i++) {
+        solarResult r;
+        calc(ref[i].day, ref[i].latitude, ref[i].longitude, 0, &r);
+
+        double t[2] = { r.sunrise, r.sunset };
+        double rt[2] = { ref[i].sunrise, ref[i].sunset };
+        std::vector<double> *perr[2] = { &rise, &set };
+        std::vector<double> *perrEvent[2] = { &riseEvent, &setEvent };
+
+        for (int j = 0; j < 2; j++) {
+            if (isnan(rt[j])) {
+                continue;
+            }
+            if (isnan(t[j])) {
+                missing[j]++;
+                continue;
+            }
+
+            perr[j]->push_back(fabs(timeDiff(t[j], rt[j])));
+
+            // As used for the events, rounded to whole seconds
+            perrEvent[j]->push_back(
+              fabs(timeDiff(solar_toSecondOfDay(t[j]) / 3600.0, rt[j])));
+        }
+    }
+
+    printf("%s\n", name);
+    report("sunrise", rise, missing[0]);
+    report("sunset", set, missing[1]);
+    report("sunrise (event)", riseEvent, missing[0]);
+    report("sunset (event)", setEvent, missing[1]);
+}
+
+// Calculations per second for an engine
+static double
+speed(void (*calc)(double, double, double, double, solarResult *),
+      const std::vector<refEntry> &ref)
+{
+    double sum = 0;
+    size_t cnt = 0;
+
+    double t0 = now();
+    do {
+        for (size_t i = 0; i < ref.size(); i++) {
+            solarResult r;
+            calc(ref[i].day, ref[i].latitude, ref[i].longitude, 0, &r);
+            sum += r.noon;
+        }
+        cnt += ref.size();
+    } while ((now() - t0) < 0.5);
+    double t = now() - t0;
+
+    // Keep the result alive
+    if (sum == 0.123) {
+        printf(" ");
+    }
+
+    return cnt / t;
+}
+
+int
+main(int argc, char **argv)
+{
+    std::vector<refEntry> ref;
+
+    if (argc > 1) {
+        if (!readReference(argv[1], ref)) {
+            return 1;
+        }
+        printf("reference: %s, %zu entries\n", argv[1], ref.size());
+    } else {
+        makeReference(ref);
+        printf("reference: NOAA engine, %zu entries\n", ref.size());
+    }
+
+    if (ref.empty()) {
+        fprintf(stderr, "No reference entries\n");
+        return 1;
+    }
+
+    compare("legacy", solar_calculateDay, ref);
+    compare("noaa", solar_calculateNoaaDay, ref);
+
+    double legacy = speed(solar_calculateDay, ref);
+    double noaa = speed(solar_calculateNoaaDay, ref);
+    printf("legacy: %12.0f calculations/s\n", legacy);
+    printf("noaa:   %12.0f calculations/s (%.1fx slower)\n",
+           noaa,
+           legacy / noaa);
+
+    return 0;
+}
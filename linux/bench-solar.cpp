@@ -0,0 +1,272 @@
+// bench-solar.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Benchmark and accuracy check for the batch solar calculation.
+//
+// Calculates sites * days tuples with the scalar code, with
+// solar_calculateBatch and with the compile time day table (one site at a
+// time and all sites for a day at a time) and reports tuples per second
+// for each and the largest difference to the scalar code.
+//
+// Usage: bench-solar [sites] [days]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+#include "solarbatch.h"
+#include "solarcalc.h"
+#include "solartable.h"
+
+// Number of fields compared
+#define BENCH_FIELDS 8
+
+static const char *fieldNames[BENCH_FIELDS] = {
+    "sunrise",         "sunset", "twilight-sunrise", "twilight-sunset",
+    "noon",            "daylength", "declination",   "max-altitude"
+};
+
+// Seconds from a monotonic clock
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Compare against the scalar result, idx maps a result index to the
+// reference index. Returns false if the difference is too large.
+static bool
+compare(const char *name,
+        std::vector<double> *ref,
+        std::vector<double> *out,
+        const std::vector<size_t> &idx)
+{
+    bool rv = true;
+
+    printf("%s\n", name);
+    for (int f = 0; f < BENCH_FIELDS; f++) {
+        double maxDiff = 0;
+        size_t nanDiff = 0;
+        for (size_t i = 0; i < out[f].size(); i++) {
+            double r = ref[f][idx[i]];
+            if (isnan(r) || isnan(out[f][i])) {
+                if (isnan(r) != isnan(out[f][i])) {
+                    nanDiff++;
+                }
+                continue;
+            }
+            double diff = fabs(r - out[f][i]);
+            if (diff > maxDiff) {
+                maxDiff = diff;
+            }
+        }
+
+        // Times are hours, show as seconds
+        bool bHours = (f < 6);
+        printf("  %-17s max diff %.3g %s, nan mismatch %zu\n",
+               fieldNames[f],
+               bHours ? maxDiff * 3600 : maxDiff,
+               bHours ? "s" : "deg",
+               nanDiff);
+
+        // One second is far below the minute resolution of the events
+        if ((bHours ? maxDiff * 3600 : maxDiff * 240) > 1.0 || nanDiff) {
+            rv = false;
+        }
+    }
+
+    return rv;
+}
+
+// Point a batch result at output vectors
+static void
+setResult(solarBatchResult *pres, std::vector<double> *out, size_t offset)
+{
+    pres->psunrise = &out[0][offset];
+    pres->psunset = &out[1][offset];
+    pres->ptwilightSunrise = &out[2][offset];
+    pres->ptwilightSunset = &out[3][offset];
+    pres->pnoon = &out[4][offset];
+    pres->pdaylength = &out[5][offset];
+    pres->pdeclination = &out[6][offset];
+    pres->pmaxAltitude = &out[7][offset];
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t sites = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+    size_t days = (argc > 2) ? strtoul(argv[2], NULL, 0) : 365;
+    size_t cnt = sites * days;
+
+    if (!cnt) {
+        fprintf(stderr, "Usage: bench-solar [sites] [days]\n");
+        return 1;
+    }
+
+    // Table must cover all days
+    if (NULL == solar_getDayTerms(2021, 1, 1) ||
+        (2021 + (days - 1) / 365) > SOLARTABLE_LAST_YEAR) {
+        fprintf(stderr,
+                "Days must be within %d-%d for the table.\n",
+                SOLARTABLE_FIRST_YEAR,
+                SOLARTABLE_LAST_YEAR);
+        return 1;
+    }
+
+    std::vector<double> day(cnt), lat(cnt), lon(cnt), tz(cnt);
+    std::vector<double> siteLat(sites), siteLon(sites), siteTz(sites);
+    std::vector<const solarDayTerms *> terms(days);
+
+    // Sites spread over the globe, consecutive days from 2021-01-01
+    srand(1);
+    double day0 = solar_dayNumber(2021, 1, 1, 0);
+    for (size_t s = 0; s < sites; s++) {
+        siteLat[s] = -85.0 + 170.0 * rand() / (double)RAND_MAX;
+        siteLon[s] = -180.0 + 360.0 * rand() / (double)RAND_MAX;
+        siteTz[s] = floor(siteLon[s] / 15.0 + 0.5);
+        for (size_t d = 0; d < days; d++) {
+            size_t i = s * days + d;
+            day[i] = day0 + d;
+            lat[i] = siteLat[s];
+            lon[i] = siteLon[s];
+            tz[i] = siteTz[s];
+        }
+    }
+
+    for (size_t d = 0; d < days; d++) {
+        struct tm tm;
+        time_t t = (time_t)(1609459200 + d * 86400); // 2021-01-01 UTC
+        gmtime_r(&t, &tm);
+        terms[d] =
+          solar_getDayTerms(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+        if (NULL == terms[d]) {
+            fprintf(stderr, "Day %zu is not in the table.\n", d);
+            return 1;
+        }
+    }
+
+    std::vector<double> ref[BENCH_FIELDS], out[BENCH_FIELDS];
+    std::vector<double> single[BENCH_FIELDS], many[BENCH_FIELDS];
+    for (int f = 0; f < BENCH_FIELDS; f++) {
+        ref[f].resize(cnt);
+        out[f].resize(cnt);
+        single[f].resize(cnt);
+        many[f].resize(cnt);
+    }
+
+    // Scalar path
+    double t0 = now();
+    for (size_t i = 0; i < cnt; i++) {
+        solarResult r;
+        solar_calculateDay(day[i], lat[i], lon[i], tz[i], &r);
+        ref[0][i] = r.sunrise;
+        ref[1][i] = r.sunset;
+        ref[2][i] = r.twilightSunrise;
+        ref[3][i] = r.twilightSunset;
+        ref[4][i] = r.noon;
+        ref[5][i] = r.daylength;
+        ref[6][i] = r.declination;
+        ref[7][i] = r.maxAltitude;
+    }
+    double tScalar = now() - t0;
+
+    // Batch path
+    solarBatchResult res;
+    setResult(&res, out, 0);
+
+    t0 = now();
+    solar_calculateBatch(cnt, &day[0], &lat[0], &lon[0], &tz[0], &res);
+    double tBatch = now() - t0;
+
+    // Table path, one site and day at a time
+    t0 = now();
+    for (size_t i = 0; i < cnt; i++) {
+        solarResult r;
+        solar_calculateFromTerms(terms[i % days], lat[i], lon[i], tz[i], &r);
+        single[0][i] = r.sunrise;
+        single[1][i] = r.sunset;
+        single[2][i] = r.twilightSunrise;
+        single[3][i] = r.twilightSunset;
+        single[4][i] = r.noon;
+        single[5][i] = r.daylength;
+        single[6][i] = r.declination;
+        single[7][i] = r.maxAltitude;
+    }
+    double tSingle = now() - t0;
+
+    // Table path, all sites for one day at a time. Result is day major.
+    t0 = now();
+    for (size_t d = 0; d < days; d++) {
+        setResult(&res, many, d * sites);
+        solar_calculateSitesFromTerms(
+          terms[d], sites, &siteLat[0], &siteLon[0], &siteTz[0], &res);
+    }
+    double tMany = now() - t0;
+
+    printf("tuples: %zu (%zu sites * %zu days)\n", cnt, sites, days);
+    printf("batch code: %s\n",
+           solar_batchIsVectorized() ? "avx2" : "scalar");
+    printf("scalar:       %12.0f tuples/s\n", cnt / tScalar);
+    printf("batch:        %12.0f tuples/s (%.2fx)\n",
+           cnt / tBatch,
+           tScalar / tBatch);
+    printf("table single: %12.0f tuples/s (%.2fx)\n",
+           cnt / tSingle,
+           tScalar / tSingle);
+    printf("table sites:  %12.0f tuples/s (%.2fx)\n",
+           cnt / tMany,
+           tScalar / tMany);
+
+    // Accuracy
+    std::vector<size_t> same(cnt), dayMajor(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        same[i] = i;
+        dayMajor[i] = (i % sites) * days + i / sites;
+    }
+
+    int rv = 0;
+    if (!compare("batch", ref, out, same)) {
+        rv = 1;
+    }
+    if (!compare("table single", ref, single, same)) {
+        rv = 1;
+    }
+    if (!compare("table sites", ref, many, dayMajor)) {
+        rv = 1;
+    }
+
+    printf("%s\n", rv ? "FAILED" : "OK");
+
+    return rv;
+}
@@ -0,0 +1,233 @@
+// bench-tick.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Cost of one pass of the worker thread when nothing is due.
+//
+// "before" is the check the worker used to do at least once a second: take
+// the local time as a vscpdatetime and compare year, month, day, hour and
+// minute with each of the five event times, and check the hour twice more
+// for the daily recalculation. vscpdatetime is not part of this tree so the
+// bench uses a stand-in that does the same work (clock read, conversion to
+// local time and field access).
+//
+// "after" is the epoch check done now: read the clock, check it for steps
+// and compare the earliest deadline of the scheduler with the time.
+//
+// Usage: bench-tick [ticks]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scheduler.h"
+
+// Default number of ticks to run
+#define BENCH_TICKS 2000000
+
+// Number of event times checked each tick
+#define BENCH_EVENTS 5
+
+// Stand-in for vscpdatetime, broken down local time
+struct benchDateTime
+{
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    int millisecond;
+
+    int getYear(void) const { return year; };
+    int getMonth(void) const { return month; };
+    int getDay(void) const { return day; };
+    int getHour(void) const { return hour; };
+    int getMinute(void) const { return minute; };
+
+    // As vscpdatetime::Now()
+    static benchDateTime Now(void)
+    {
+        struct timespec ts;
+        struct tm tm;
+        benchDateTime dt;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        localtime_r(&ts.tv_sec, &tm);
+        dt.year = tm.tm_year + 1900;
+        dt.month = tm.tm_mon;
+        dt.day = tm.tm_mday;
+        dt.hour = tm.tm_hour;
+        dt.minute = tm.tm_min;
+        dt.second = tm.tm_sec;
+        dt.millisecond = ts.tv_nsec / 1000000;
+        return dt;
+    };
+};
+
+// Seconds from a monotonic clock
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Event times a day ahead so nothing is due
+static void
+makeTimes(benchDateTime* ptimes, time_t* pepochs)
+{
+    time_t t = time(NULL) + 24 * 3600;
+    struct tm tm;
+
+    for (int i = 0; i < BENCH_EVENTS; i++) {
+        pepochs[i] = t + i * 3600;
+        localtime_r(&pepochs[i], &tm);
+        ptimes[i].year = tm.tm_year + 1900;
+        ptimes[i].month = tm.tm_mon;
+        ptimes[i].day = tm.tm_mday;
+        ptimes[i].hour = tm.tm_hour;
+        ptimes[i].minute = tm.tm_min;
+        ptimes[i].second = 0;
+        ptimes[i].millisecond = 0;
+    }
+}
+
+// One pass of the old worker check, returns the number of due events
+static int
+tickBefore(const benchDateTime* ptimes, bool* pbCalcDone)
+{
+    int due = 0;
+    benchDateTime now = benchDateTime::Now();
+
+    if (!*pbCalcDone && (0 == benchDateTime::Now().getHour())) {
+        *pbCalcDone = true;
+        due++;
+    }
+
+    if (0 != benchDateTime::Now().getHour()) {
+        *pbCalcDone = false;
+    }
+
+    for (int i = 0; i < BENCH_EVENTS; i++) {
+        if ((now.getYear() == ptimes[i].getYear()) &&
+            (now.getMonth() == ptimes[i].getMonth()) &&
+            (now.getDay() == ptimes[i].getDay()) &&
+            (now.getHour() == ptimes[i].getHour()) &&
+            (now.getMinute() == ptimes[i].getMinute())) {
+            due++;
+        }
+    }
+
+    return due;
+}
+
+// One pass of the epoch check, returns the number of due events
+static int
+tickAfter(CScheduler& sched, time_t* pcheckedUntil)
+{
+    int due = 0;
+    schedEntry entry;
+    time_t next;
+    time_t t = time(NULL);
+
+    int64_t jump = sched.checkClock();
+    if ((jump >= 5000000) || (jump <= -5000000)) {
+        due++;
+    }
+
+    while (sched.popDue(t, &entry)) {
+        *pcheckedUntil = entry.deadline - 1;
+        due++;
+    }
+
+    if (!sched.peekDeadline(&next) || (next > t)) {
+        *pcheckedUntil = t;
+    }
+
+    return due;
+}
+
+int
+main(int argc, char** argv)
+{
+    long ticks = BENCH_TICKS;
+    benchDateTime times[BENCH_EVENTS];
+    time_t epochs[BENCH_EVENTS];
+    CScheduler sched;
+    bool bCalcDone = false;
+    time_t checkedUntil = 0;
+    long due = 0;
+
+    if (argc > 1) {
+        ticks = atol(argv[1]);
+    }
+
+    if (ticks <= 0) {
+        fprintf(stderr, "Usage: bench-tick [ticks]\n");
+        return 1;
+    }
+
+    makeTimes(times, epochs);
+    for (int i = 0; i < BENCH_EVENTS; i++) {
+        sched.addDeadline(epochs[i], i);
+    }
+
+    double start = now();
+    for (long i = 0; i < ticks; i++) {
+        due += tickBefore(times, &bCalcDone);
+    }
+    double before = (now() - start) * 1e9 / ticks;
+
+    start = now();
+    for (long i = 0; i < ticks; i++) {
+        due += tickAfter(sched, &checkedUntil);
+    }
+    double after = (now() - start) * 1e9 / ticks;
+
+    printf("ticks            %ld\n", ticks);
+    printf("before (fields)  %8.1f ns/tick\n", before);
+    printf("after (epoch)    %8.1f ns/tick\n", after);
+    printf("speedup          %8.1f x\n", before / after);
+
+    // The old worker checked at least once a second, the scheduler only
+    // wakes for the deadlines of the day
+    printf("per day before   %8.1f us (86400 ticks)\n", before * 86400 / 1000);
+    printf("per day after    %8.1f us (%d ticks)\n",
+           after * (BENCH_EVENTS + 1) / 1000,
+           BENCH_EVENTS + 1);
+
+    // Keep the work from being optimized away
+    if (due < 0) {
+        printf("%ld\n", due);
+    }
+
+    return 0;
+}
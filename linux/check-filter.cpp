@@ -0,0 +1,302 @@
+// check-filter.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Check of the compiled event filters against a plain implementation.
+//
+// The reference checks each field byte by byte in the same way as
+// vscp_doLevel2Filter() in the vscp helper library, which is not linked
+// here so the check can be built on its own. A single filter/mask pair is
+// checked with CEventFilter and ordered rule lists of up to
+// FILTER_MAX_RULES rules with the indexed CFilterRules, whose result must
+// be the same as trying the rules one at a time.
+//
+// Filters and events are made from few values so that exact matches,
+// partial masks and rules that name the same class/type are common.
+//
+// Usage: check-filter [cases] [seed]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "eventfilter.h"
+
+// Default number of events checked for each kind of test
+#define CHECK_CASES 1000000
+
+// Number of events checked against each rule set
+#define CHECK_EVENTS_PER_SET 200
+
+// One rule of a reference rule list
+struct checkRule
+{
+    vscpEventFilter filter;
+    bool bAllow;
+};
+
+// Random number below n
+static unsigned
+rnd(unsigned n)
+{
+    return (unsigned)(((uint64_t)rand() * n) / ((uint64_t)RAND_MAX + 1));
+}
+
+// Random value of a field, often zero or all ones
+static uint32_t
+rndField(uint32_t mask)
+{
+    switch (rnd(4)) {
+        case 0:
+            return 0;
+        case 1:
+            return mask;
+        case 2:
+            return rnd(8) & mask;
+        default:
+            return (uint32_t)rand() & mask;
+    }
+}
+
+// Byte by byte filter check as done by vscp_doLevel2Filter()
+static bool
+refFilter(const vscpEventEx &ex, const vscpEventFilter &filter)
+{
+    uint8_t priority = (ex.head >> 5) & 0x07;
+
+    if (0xff != (uint8_t)(~(filter.filter_priority ^ priority) |
+                          ~filter.mask_priority)) {
+        return false;
+    }
+
+    if (0xffff != (uint16_t)(~(filter.filter_class ^ ex.vscp_class) |
+                             ~filter.mask_class)) {
+        return false;
+    }
+
+    if (0xffff != (uint16_t)(~(filter.filter_type ^ ex.vscp_type) |
+                             ~filter.mask_type)) {
+        return false;
+    }
+
+    for (int i = 0; i < 16; i++) {
+        if (0xff != (uint8_t)(~(filter.filter_GUID[i] ^ ex.GUID[i]) |
+                              ~filter.mask_GUID[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// First matching rule decides, no match passes only without allow rules
+static bool
+refRules(const vscpEventEx &ex, const std::vector<checkRule> &rules)
+{
+    bool bAllowRules = false;
+
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (refFilter(ex, rules[i].filter)) {
+            return rules[i].bAllow;
+        }
+        bAllowRules = bAllowRules || rules[i].bAllow;
+    }
+
+    return !bAllowRules;
+}
+
+// Filter with random fields and masks
+static void
+makeFilter(vscpEventFilter *pfilter)
+{
+    memset(pfilter, 0, sizeof(vscpEventFilter));
+
+    pfilter->filter_priority = rndField(0xff);
+    pfilter->mask_priority = rnd(2) ? rndField(0xff) : 0;
+    pfilter->filter_class = rndField(0xffff);
+    pfilter->mask_class = rndField(0xffff);
+    pfilter->filter_type = rndField(0xffff);
+    pfilter->mask_type = rndField(0xffff);
+
+    if (rnd(3)) {
+        for (int i = 0; i < 16; i++) {
+            pfilter->filter_GUID[i] = rndField(0xff);
+            pfilter->mask_GUID[i] = rnd(4) ? 0 : rndField(0xff);
+        }
+    }
+}
+
+// Event that is often close to a filter
+static void
+makeEvent(vscpEventEx *pex, const vscpEventFilter &near)
+{
+    memset(pex, 0, sizeof(vscpEventEx));
+
+    pex->head = rnd(2) ? (near.filter_priority << 5) : (rnd(8) << 5);
+    pex->vscp_class = rnd(2) ? near.filter_class : rndField(0xffff);
+    pex->vscp_type = rnd(2) ? near.filter_type : rndField(0xffff);
+    for (int i = 0; i < 16; i++) {
+        pex->GUID[i] = rnd(8) ? near.filter_GUID[i] : rndField(0xff);
+    }
+}
+
+// Single filter/mask pairs
+static bool
+checkFilter(long cases)
+{
+    long mismatch = 0;
+    long passed = 0;
+
+    for (long i = 0; i < cases; i++) {
+        vscpEventFilter filter;
+        vscpEventEx ex;
+        CEventFilter compiled;
+
+        makeFilter(&filter);
+        makeEvent(&ex, filter);
+        compiled.set(filter);
+
+        bool bRef = refFilter(ex, filter);
+        if (compiled.match(ex) != bRef) {
+            if (!mismatch) {
+                fprintf(stderr,
+                        "  filter class %04x/%04x type %04x/%04x prio "
+                        "%02x/%02x event class %04x type %04x head %02x\n",
+                        filter.filter_class,
+                        filter.mask_class,
+                        filter.filter_type,
+                        filter.mask_type,
+                        filter.filter_priority,
+                        filter.mask_priority,
+                        ex.vscp_class,
+                        ex.vscp_type,
+                        ex.head);
+            }
+            mismatch++;
+        }
+
+        if (bRef) {
+            passed++;
+        }
+    }
+
+    printf("  filter  %ld events, %ld passed, %ld mismatch\n",
+           cases,
+           passed,
+           mismatch);
+
+    return !mismatch;
+}
+
+// Ordered rule lists
+static bool
+checkRules(long cases)
+{
+    long mismatch = 0;
+    long passed = 0;
+    long events = 0;
+    std::vector<checkRule> rules;
+    vscpEventFilter none;
+
+    memset(&none, 0, sizeof(none));
+
+    while (events < cases) {
+
+        // Mostly short lists, now and then a large one
+        size_t count = rnd(16) ? rnd(24) : rnd(FILTER_MAX_RULES + 1);
+
+        CFilterRules compiled;
+        rules.clear();
+        for (size_t i = 0; i < count; i++) {
+            checkRule rule;
+            makeFilter(&rule.filter);
+            rule.bAllow = rnd(2);
+            rules.push_back(rule);
+            compiled.add(rule.filter, rule.bAllow);
+        }
+        compiled.compile();
+
+        for (int j = 0; j < CHECK_EVENTS_PER_SET; j++, events++) {
+            vscpEventEx ex;
+            makeEvent(&ex, count ? rules[rnd(count)].filter : none);
+
+            bool bRef = refRules(ex, rules);
+            if (compiled.match(ex) != bRef) {
+                if (!mismatch) {
+                    fprintf(stderr,
+                            "  %zu rules, event class %04x type %04x head "
+                            "%02x\n",
+                            count,
+                            ex.vscp_class,
+                            ex.vscp_type,
+                            ex.head);
+                }
+                mismatch++;
+            }
+
+            if (bRef) {
+                passed++;
+            }
+        }
+    }
+
+    printf("  rules   %ld events, %ld passed, %ld mismatch\n",
+           events,
+           passed,
+           mismatch);
+
+    return !mismatch;
+}
+
+int
+main(int argc, char **argv)
+{
+    long cases = (argc > 1) ? atol(argv[1]) : CHECK_CASES;
+    unsigned seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+
+    if (cases <= 0) {
+        fprintf(stderr, "Usage: check-filter [cases] [seed]\n");
+        return 1;
+    }
+
+    srand(seed);
+
+    int rv = 0;
+    if (!checkFilter(cases)) {
+        rv = 1;
+    }
+    if (!checkRules(cases)) {
+        rv = 1;
+    }
+
+    printf("%s\n", rv ? "FAILED" : "OK");
+
+    return rv;
+}
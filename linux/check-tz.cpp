@@ -0,0 +1,206 @@
+// check-tz.cpp
+//
+// This file is part of the VSCP (http://www.vscp.org)
+//
+// The MIT License (MIT)
+//
+// Copyright (C) 2000-2021 Ake Hedman, Grodans Paradis AB
+// <info@grodansparadis.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Check of the time zone code against the time functions of libc.
+//
+// For each zone the offset from UTC and the local date are compared with
+// localtime_r() with TZ set to the zone, every hour and one second before
+// every hour of the years checked. The start of each local day is
+// compared with the first second that localtime_r() puts on that day.
+// Years after the last transition in the tzfile exercise the POSIX rule
+// at the end of the file.
+//
+// The zones in the list are used unless zones are given on the command
+// line. Zones that are not installed are skipped.
+//
+// Usage: check-tz [first-year] [last-year] [zone...]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tzinfo.h"
+
+// Default years to check
+#define CHECK_FIRST_YEAR 2000
+#define CHECK_LAST_YEAR  2060
+
+// Zones with rules of different kinds: both hemispheres, half hour and
+// 45 minute offsets, 30 minute DST, DST changes at midnight and no DST
+static const char *checkZones[] = {
+    "Europe/Stockholm", "Europe/London",       "America/New_York",
+    "America/Sao_Paulo", "America/Santiago",   "Australia/Sydney",
+    "Australia/Lord_Howe", "Asia/Kolkata",     "Asia/Tehran",
+    "Pacific/Auckland", "Pacific/Chatham",     "Africa/Johannesburg"
+};
+
+// Seconds since epoch at the start of a UTC year
+static int64_t
+yearStart(int year)
+{
+    return (int64_t)CTimeZone::daysFromCivil(year, 1, 1) * 86400;
+}
+
+// Check one zone, returns the number of mismatches
+static long
+checkZone(const char *pname, int firstYear, int lastYear)
+{
+    long mismatch = 0;
+    long count = 0;
+    struct tm tm;
+
+    std::string path = std::string(TZINFO_DEFAULT_DIR) + "/" + pname;
+    if (NULL != getenv("TZDIR")) {
+        path = std::string(getenv("TZDIR")) + "/" + pname;
+    }
+
+    FILE *pf = fopen(path.c_str(), "rb");
+    if (NULL == pf) {
+        printf("  %-20s not installed, skipped\n", pname);
+        return 0;
+    }
+    fclose(pf);
+
+    const CTimeZone *pzone = CTimeZone::get(pname);
+    if (NULL == pzone) {
+        printf("  %-20s could not be loaded\n", pname);
+        return 1;
+    }
+
+    setenv("TZ", pname, 1);
+    tzset();
+
+    // Offset and local date
+    int64_t end = yearStart(lastYear + 1);
+    for (int64_t hour = yearStart(firstYear); hour < end; hour += 3600) {
+        for (int64_t utc = hour - 1; utc <= hour; utc++) {
+
+            time_t t = (time_t)utc;
+            localtime_r(&t, &tm);
+            count++;
+
+            int year, month, day;
+            int32_t offset = pzone->getOffset(utc);
+            pzone->getLocalDate(utc, &year, &month, &day);
+
+            if ((offset != tm.tm_gmtoff) || (year != tm.tm_year + 1900) ||
+                (month != tm.tm_mon + 1) || (day != tm.tm_mday)) {
+                if (mismatch < 5) {
+                    printf("  %-20s %lld offset %d libc %ld date "
+                           "%04d-%02d-%02d libc %04d-%02d-%02d\n",
+                           pname,
+                           (long long)utc,
+                           offset,
+                           (long)tm.tm_gmtoff,
+                           year,
+                           month,
+                           day,
+                           tm.tm_year + 1900,
+                           tm.tm_mon + 1,
+                           tm.tm_mday);
+                }
+                mismatch++;
+            }
+        }
+    }
+
+    // Start of each local day
+    int32_t lastDay = CTimeZone::daysFromCivil(lastYear, 12, 31);
+    for (int32_t days = CTimeZone::daysFromCivil(firstYear, 1, 1);
+         days <= lastDay;
+         days++) {
+
+        int year, month, day;
+        CTimeZone::civilFromDays(days, &year, &month, &day);
+        int64_t midnight = pzone->getMidnight(year, month, day);
+        count++;
+
+        // The first second of the day is on the day, the one before is not
+        time_t t = (time_t)midnight;
+        localtime_r(&t, &tm);
+        bool bOk = (tm.tm_year + 1900 == year) && (tm.tm_mon + 1 == month) &&
+                   (tm.tm_mday == day);
+        t = (time_t)(midnight - 1);
+        localtime_r(&t, &tm);
+        bOk = bOk && (tm.tm_mday != day);
+
+        if (!bOk) {
+            if (mismatch < 5) {
+                printf("  %-20s midnight %04d-%02d-%02d is %lld\n",
+                       pname,
+                       year,
+                       month,
+                       day,
+                       (long long)midnight);
+            }
+            mismatch++;
+        }
+    }
+
+    printf("  %-20s %zu transitions, %ld checks, %ld mismatch\n",
+           pname,
+           pzone->getTransitionCount(),
+           count,
+           mismatch);
+
+    return mismatch;
+}
+
+int
+main(int argc, char **argv)
+{
+    int firstYear = (argc > 1) ? atoi(argv[1]) : CHECK_FIRST_YEAR;
+    int lastYear = (argc > 2) ? atoi(argv[2]) : CHECK_LAST_YEAR;
+    long mismatch = 0;
+
+    if ((firstYear < 1970) || (lastYear < firstYear) ||
+        (lastYear > TZINFO_LAST_YEAR)) {
+        fprintf(stderr,
+                "Usage: check-tz [first-year] [last-year] [zone...]\n"
+                "Years must be within 1970-%d\n",
+                TZINFO_LAST_YEAR);
+        return 1;
+    }
+
+    if (argc > 3) {
+        for (int i = 3; i < argc; i++) {
+            mismatch += checkZone(argv[i], firstYear, lastYear);
+        }
+    } else {
+        size_t count = sizeof(checkZones) / sizeof(checkZones[0]);
+        for (size_t i = 0; i < count; i++) {
+            mismatch += checkZone(checkZones[i], firstYear, lastYear);
+        }
+    }
+
+    printf("%s\n", mismatch ? "FAILED" : "OK");
+
+    return mismatch ? 1 : 0;
+}
@@ -26,13 +26,13 @@
 #endif
 
 #include <list>
-#include <map>
 #include <string>
 
 #include "stdio.h"
 #include "stdlib.h"
 
 #include "automation.h"
+#include "handletable.h"
 #include "vscpl2drv-automation.h"
 
 void
@@ -40,11 +40,8 @@ _init() __attribute__((constructor));
 void
 _fini() __attribute__((destructor));
 
-// This map holds driver handles/objects
-static std::map<long, CAutomation *> g_ifMap;
-
-// Mutex for the map object
-static pthread_mutex_t g_mapMutex;
+// This table holds driver handles/objects
+static CHandleTable<CAutomation> g_handles;
 
 ////////////////////////////////////////////////////////////////////////////
 // DLL constructor
@@ -53,7 +50,20 @@ static pthread_mutex_t g_mapMutex;
 void
 _init()
 {
-    pthread_mutex_init(&g_mapMutex, NULL);
+    ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// wakeReaders
+//
+// Called when a handle is removed so host threads blocked in a read on
+// it return before the handle table waits for them.
+//
+
+static void
+wakeReaders(CAutomation *pdrvObj)
+{
+    pdrvObj->wakeReaders();
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -63,210 +73,340 @@ _init()
 void
 _fini()
 {
-    // If empty - nothing to do
-    if (g_ifMap.empty()) return;
+    CAutomation *pif;
 
     // Remove orphan objects
+    while (NULL != (pif = g_handles.removeAny(wakeReaders))) {
+        pif->close();
+        delete pif;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//               V S C P   L E V E L  I I  D R I V E R -  A P I
+///////////////////////////////////////////////////////////////////////////////
 
-    LOCK_MUTEX(g_mapMutex);
+///////////////////////////////////////////////////////////////////////////////
+// VSCPOpen
+//
 
-    for (std::map<long, CAutomation *>::iterator it = g_ifMap.begin();
-         it != g_ifMap.end();
-         ++it) {
+extern "C" long
+VSCPOpen(const char *pPathConfig, const char *pguid )
+{
+    long h = 0;
 
-        CAutomation *pif = it->second;
-        if (NULL != pif) {
-            pif->close();
-            delete pif;
-            pif = NULL;
+    CAutomation *pdrvObj = new CAutomation();
+    if (NULL != pdrvObj) {
+
+        cguid guid(pguid);
+        if (pdrvObj->open(pPathConfig, guid)) {
+
+            if (!(h = g_handles.add(pdrvObj))) {
+                pdrvObj->close();
+                delete pdrvObj;
+            }
+
+        } else {
+            delete pdrvObj;
         }
     }
 
-    g_ifMap.clear(); // Remove all items
-
-    UNLOCK_MUTEX(g_mapMutex);
-    pthread_mutex_destroy(&g_mapMutex);
+    return h;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// addDriverObject
+//  VSCPClose
 //
 
-long
-addDriverObject(CAutomation *pif)
+extern "C" int
+VSCPClose(long handle)
 {
-    std::map<long, CAutomation *>::iterator it;
-    long h = 0;
+    // Wakes blocked reads and waits for calls in progress on the handle
+    CAutomation *pdrvObj = g_handles.remove(handle, wakeReaders);
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
+    pdrvObj->close();
+    delete pdrvObj;
 
-    LOCK_MUTEX(g_mapMutex);
+    return CANAL_ERROR_SUCCESS;
+}
 
-    // Find free handle
-    while (true) {
-        if (g_ifMap.end() == (it = g_ifMap.find(h))) break;
-        h++;
-    };
+///////////////////////////////////////////////////////////////////////////////
+//  VSCPWrite
+//
 
-    g_ifMap[h] = pif;
-    h += 1681;
+extern "C" int
+VSCPWrite(long handle, const vscpEvent *pEvent, unsigned long timeout)
+{
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
 
-    UNLOCK_MUTEX(g_mapMutex);
+    if (!pdrvObj->addEvent2SendQueue(pEvent)) {
+        return CANAL_ERROR_MEMORY;
+    }
 
-    return h;
+    return CANAL_ERROR_SUCCESS;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// getDriverObject
+//  VSCPRead
 //
 
-CAutomation *
-getDriverObject(long h)
+extern "C" int
+VSCPRead(long handle, vscpEvent *pEvent, unsigned long timeout)
 {
-    std::map<long, CAutomation *>::iterator it;
-    long idx = h - 1681;
+    // Check pointer
+    if (NULL == pEvent) return CANAL_ERROR_PARAMETER;
+
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
 
-    // Check if valid handle
-    if (idx < 0) return NULL;
+    vscpEvent *pLocalEvent;
+    if (!pdrvObj->popReceiveEvent(&pLocalEvent, timeout)) {
+        return CANAL_ERROR_TIMEOUT;
+    }
 
-    it = g_ifMap.find(idx);
-    if (it != g_ifMap.end()) {
-        return it->second;
+    if (NULL == pLocalEvent) {
+        return CANAL_ERROR_MEMORY;
     }
 
-    return NULL;
+    vscp_copyEvent(pEvent, pLocalEvent);
+    pdrvObj->m_receivePool.release(pLocalEvent);
+
+    return CANAL_ERROR_SUCCESS;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// removeDriverObject
+//  VSCPReadNoCopy
+//
+//  Hand over the queued event itself instead of a copy. The event is owned
+//  by the driver and must be given back with VSCPReleaseEvent before the
+//  driver is closed.
 //
 
-void
-removeDriverObject(long h)
+extern "C" int
+VSCPReadNoCopy(long handle, vscpEvent **ppEvent, unsigned long timeout)
 {
-    std::map<long, CAutomation *>::iterator it;
-    long idx = h - 1681;
-
-    // Check if valid handle
-    if (idx < 0) return;
-
-    LOCK_MUTEX(g_mapMutex);
-    it = g_ifMap.find(idx);
-    if (it != g_ifMap.end()) {
-        CAutomation *pObj = it->second;
-        if (NULL != pObj) {
-            delete pObj;
-            pObj = NULL;
-        }
-        g_ifMap.erase(it);
+    // Check pointer
+    if (NULL == ppEvent) return CANAL_ERROR_PARAMETER;
+    *ppEvent = NULL;
+
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
+
+    vscpEvent *pLocalEvent;
+    if (!pdrvObj->popReceiveEvent(&pLocalEvent, timeout)) {
+        return CANAL_ERROR_TIMEOUT;
     }
-    UNLOCK_MUTEX(g_mapMutex);
+
+    if (NULL == pLocalEvent) {
+        return CANAL_ERROR_MEMORY;
+    }
+
+    *ppEvent = pLocalEvent;
+
+    return CANAL_ERROR_SUCCESS;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//               V S C P   L E V E L  I I  D R I V E R -  A P I
-///////////////////////////////////////////////////////////////////////////////
+//  VSCPReleaseEvent
+//
+//  Give back an event received with VSCPReadNoCopy. Pointers that are not
+//  events of the driver and events already given back are rejected.
+//
+
+extern "C" int
+VSCPReleaseEvent(long handle, vscpEvent *pEvent)
+{
+    // Check pointer
+    if (NULL == pEvent) return CANAL_ERROR_PARAMETER;
+
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
+
+    // Only events handed out by VSCPReadNoCopy and not yet given back
+    if (!pdrvObj->m_receivePool.owns(pEvent) ||
+        !pdrvObj->m_receivePool.release(pEvent)) {
+        return CANAL_ERROR_PARAMETER;
+    }
+
+    return CANAL_ERROR_SUCCESS;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-// VSCPOpen
+//  VSCPReadEx
+//
+//  Fill the callers ex event directly from the queued event. No memory is
+//  allocated for the data part.
 //
 
-extern "C" long
-VSCPOpen(const char *pPathConfig, const char *pguid )
+extern "C" int
+VSCPReadEx(long handle, vscpEventEx *pEventEx, unsigned long timeout)
 {
-    long h = 0;
-
-    CAutomation *pdrvObj = new CAutomation();
-    if (NULL != pdrvObj) {
+    // Check pointer
+    if (NULL == pEventEx) return CANAL_ERROR_PARAMETER;
 
-        cguid guid(pguid);
-        if (pdrvObj->open(pPathConfig, guid)) {
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
 
-            if (!(h = addDriverObject(pdrvObj))) {
-                delete pdrvObj;
-            }
+    vscpEvent *pLocalEvent;
+    if (!pdrvObj->popReceiveEvent(&pLocalEvent, timeout)) {
+        return CANAL_ERROR_TIMEOUT;
+    }
 
-        } else {
-            delete pdrvObj;
-        }
+    if (NULL == pLocalEvent) {
+        return CANAL_ERROR_MEMORY;
     }
 
-    return h;
+    vscp_convertEventToEventEx(pEventEx, pLocalEvent);
+    pdrvObj->m_receivePool.release(pLocalEvent);
+
+    return CANAL_ERROR_SUCCESS;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//  VSCPClose
+//  VSCPWriteBatch
+//
+//  Write several events in one call. The number of events actually queued
+//  is returned in pWritten. The send queue is unbounded so the call never
+//  blocks and timeout is not used. It is there to match VSCPWrite.
 //
 
 extern "C" int
-VSCPClose(long handle)
+VSCPWriteBatch(long handle,
+               const vscpEvent *const *ppEvents,
+               unsigned int count,
+               unsigned int *pWritten,
+               __attribute__((unused)) unsigned long timeout)
 {
-    CAutomation *pdrvObj = getDriverObject(handle);
+    // Check pointers
+    if ((NULL == ppEvents) || (NULL == pWritten)) return CANAL_ERROR_PARAMETER;
+    *pWritten = 0;
+
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
     if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
-    pdrvObj->close();
-    removeDriverObject(handle);
+
+    *pWritten = (unsigned int)pdrvObj->addEvents2SendQueue(ppEvents, count);
+    if (*pWritten < count) {
+        return CANAL_ERROR_MEMORY;
+    }
 
     return CANAL_ERROR_SUCCESS;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//  VSCPWrite
+//  VSCPReadBatch
+//
+//  Read up to count events in one call. Waits up to timeout milliseconds for
+//  the first event, the rest are the ones already waiting. The number of
+//  events actually read is returned in pRead. As for VSCPRead the caller
+//  owns the data of the returned events.
 //
 
 extern "C" int
-VSCPWrite(long handle, const vscpEvent *pEvent, unsigned long timeout)
+VSCPReadBatch(long handle,
+              vscpEvent *pEvents,
+              unsigned int count,
+              unsigned int *pRead,
+              unsigned long timeout)
 {
-    CAutomation *pdrvObj = getDriverObject(handle);
+    // Check pointers
+    if ((NULL == pEvents) || (NULL == pRead)) return CANAL_ERROR_PARAMETER;
+    *pRead = 0;
+
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
     if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
 
-    pdrvObj->addEvent2SendQueue(pEvent);
+    if (!count) return CANAL_ERROR_SUCCESS;
+
+    vscpEvent *pLocalEvent;
+    if (!pdrvObj->popReceiveEvent(&pLocalEvent, timeout)) {
+        return CANAL_ERROR_TIMEOUT;
+    }
+
+    do {
+        if (NULL != pLocalEvent) {
+            vscp_copyEvent(&pEvents[*pRead], pLocalEvent);
+            pdrvObj->m_receivePool.release(pLocalEvent);
+            (*pRead)++;
+        }
+    } while ((*pRead < count) && pdrvObj->popReceiveEvent(&pLocalEvent, 0));
 
     return CANAL_ERROR_SUCCESS;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//  VSCPRead
+//  VSCPGetEventFd
+//
+//  Get a file descriptor that is readable as long as there are events to
+//  read. Can be used with poll/epoll to serve many drivers from one thread.
+//  The descriptor is owned by the driver and is closed by VSCPClose.
 //
 
 extern "C" int
-VSCPRead(long handle, vscpEvent *pEvent, unsigned long timeout)
+VSCPGetEventFd(long handle)
 {
-    int rv = 0;
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return -1;
 
-    // Check pointer
-    if (NULL == pEvent) return CANAL_ERROR_PARAMETER;
+    return pdrvObj->getReceiveFd();
+}
 
-    CAutomation *pdrvObj = getDriverObject(handle);
-    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
+///////////////////////////////////////////////////////////////////////////////
+//  VSCPGetStatistics
+//
+//  Get latency and pool statistics as a JSON string. Works like snprintf,
+//  the return value is the length of the whole string and the buffer gets
+//  as much of it as fits (always terminated if size > 0).
+//
 
-    if (-1 == (rv = vscp_sem_wait(&pdrvObj->m_semReceiveQueue, timeout))) {
-        if (ETIMEDOUT == errno) {
-            return CANAL_ERROR_TIMEOUT;
-        } else if (EINTR == errno) {
-            syslog(LOG_ERR, "[vscpl2drv-automation] Interrupted by a signal handler");
-            return CANAL_ERROR_INTERNAL;
-        } else if (EINVAL == errno) {
-            syslog(LOG_ERR, "[vscpl2drv-automation] Invalid semaphore (timout)");
-            return CANAL_ERROR_INTERNAL;
-        } else if (EAGAIN == errno) {
-            syslog(LOG_ERR, "[vscpl2drv-automation] Blocking error");
-            return CANAL_ERROR_INTERNAL;
-        } else {
-            syslog(LOG_ERR, "[vscpl2drv-automation] Unknown error");
-            return CANAL_ERROR_INTERNAL;
-        }
-    }
+extern "C" int
+VSCPGetStatistics(long handle, char *pbuf, size_t size)
+{
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return -1;
 
-    pthread_mutex_lock(&pdrvObj->m_mutexReceiveQueue);
-    vscpEvent *pLocalEvent = pdrvObj->m_receiveList.front();
-    if (NULL == pLocalEvent) {
-        pdrvObj->m_receiveList.pop_front();
-        pthread_mutex_unlock(&pdrvObj->m_mutexReceiveQueue);
-        return CANAL_ERROR_MEMORY;
+    std::string str;
+    pdrvObj->getStatistics(str);
+
+    if ((NULL != pbuf) && size) {
+        size_t n = (str.length() < size) ? str.length() : size - 1;
+        memcpy(pbuf, str.c_str(), n);
+        pbuf[n] = 0;
     }
-    pdrvObj->m_receiveList.pop_front();
-    pthread_mutex_unlock(&pdrvObj->m_mutexReceiveQueue);
 
-    vscp_copyEvent(pEvent, pLocalEvent);
-    vscp_deleteEvent(pLocalEvent);
+    return (int)str.length();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  VSCPSetFilterRules
+//
+//  Replace the output filter rules of a running driver. The rules are a
+//  JSON array in the same format as "filter-rules" in the configuration.
+//  The worker thread picks up the new rules without being stopped.
+//
+
+extern "C" int
+VSCPSetFilterRules(long handle, const char *pRules)
+{
+    // Check pointer
+    if (NULL == pRules) return CANAL_ERROR_PARAMETER;
+
+    CHandleRef<CAutomation> drvRef(g_handles, handle);
+    CAutomation *pdrvObj = drvRef.get();
+    if (NULL == pdrvObj) return CANAL_ERROR_MEMORY;
+
+    if (!pdrvObj->loadFilterRules(pRules)) {
+        return CANAL_ERROR_PARAMETER;
+    }
 
     return CANAL_ERROR_SUCCESS;
 }
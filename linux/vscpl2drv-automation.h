@@ -67,32 +67,4 @@ typedef int BOOL;
 "</config>"
 
 
-/*!
-    Add a driver object
-
-    @parm plog Object to add
-    @return handle or 0 for error
-*/
-long
-addDriverObject(CAutomation *pif);
-
-/*!
-    Get a driver object from its handle
-
-    @param handle for object
-    @return pointer to object or NULL if invalid
-            handle.
-*/
-CAutomation *
-getDriverObject(long handle);
-
-/*!
-    Remove a driver object
-    @param handle for object.
-*/
-void
-removeDriverObject(long handle);
-
-
-
 #endif // !defined(VSCPL2AUTOMATION_H__A388C093_AD35_4672_8BF7_DBC702C6B0C8__INCLUDED_)